@@ -1,11 +1,17 @@
 #include "AVLHTree.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <iterator>
 
 using namespace std;
 
 Permissions::Permissions() : owner(7), group(5), others(5) {}
 
+uint16_t Permissions::mode() const {
+    return (owner << 6) | (group << 3) | others;
+}
+
 string Permissions::toRWX(int perm) const {
     string result;
     result += (perm & 4) ? 'r' : '-';
@@ -18,37 +24,83 @@ string Permissions::toString() const {
     return toRWX(owner) + toRWX(group) + toRWX(others);
 }
 
-FSNode::FSNode(const string& name, NodeType type, FSNode* parent)
-    : name(name), type(type), parent(parent) {}
+FSNode::FSNode(string_view name, NodeType type, FSNode* parent, InodeTable* table, uint32_t ino)
+    : parent(parent), nameHash(HashFunction::hash(name)), ino(ino), type(type), attached(true),
+      name(table->names().intern(name)), table(table) {
+    if (type == NodeType::DIRECTORY) {
+        payload.emplace<unique_ptr<HTreeIndex>>(make_unique<HTreeIndex>());
+    }
+}
+
+NodePtr FSNode::create(string_view name, NodeType type, FSNode* parent) {
+    return InodeTable::global().create(name, type, parent);
+}
+
+InodeTable* FSNode::inodeTable() const { return table; }
+
+NodePtr FSNode::parentHandle(string* currentName) const {
+    ReadLock guard(table->lockOf(ino));
+    if (currentName) {
+        *currentName = name;
+    }
+    return parent && parent->tryRetain() ? NodePtr(parent, adopt_lock) : nullptr;
+}
+
+Usage FSNode::usage() const {
+    if (isFile()) {
+        return {static_cast<int64_t>(content().length()), 1, 0};
+    }
+    Usage result = htree().usage();
+    result.dirs++;
+    return result;
+}
 
 bool FSNode::isDirectory() const { return type == NodeType::DIRECTORY; }
 bool FSNode::isFile() const { return type == NodeType::FILE; }
 
-shared_ptr<FSNode> FSNode::findChild(const string& childName) {
+Rope& FSNode::content() { return get<Rope>(payload); }
+const Rope& FSNode::content() const { return get<Rope>(payload); }
+HTreeIndex& FSNode::htree() { return *get<unique_ptr<HTreeIndex>>(payload); }
+const HTreeIndex& FSNode::htree() const { return *get<unique_ptr<HTreeIndex>>(payload); }
+
+NodePtr FSNode::findChild(string_view childName) {
+    return findChild(childName, HashFunction::hash(childName));
+}
+
+NodePtr FSNode::findChild(string_view childName, uint32_t childHash) {
     if (!isDirectory()) return nullptr;
-    return htree.find(childName);
+    return htree().find(childName, childHash);
 }
 
-void FSNode::addChild(shared_ptr<FSNode> child, bool silent) {
+void FSNode::addChild(NodePtr child, bool silent) {
     if (!isDirectory()) return;
-    htree.insert(child->name, child);
+    htree().insert(child->name, child);
     if (!silent) {
         cout << "  [AVL H-Tree] Добавлен '" << child->name 
-             << "' (hash: " << HashFunction::hash(child->name) << ")" << endl;
+             << "' (hash: " << child->nameHash << ")" << endl;
     }
 }
 
-bool FSNode::removeChild(const string& childName) {
+bool FSNode::removeChild(string_view childName) {
+    return removeChild(childName, HashFunction::hash(childName));
+}
+
+bool FSNode::removeChild(string_view childName, uint32_t childHash) {
     if (!isDirectory()) return false;
-    return htree.remove(childName);
+    return htree().remove(childName, childHash);
 }
 
-vector<shared_ptr<FSNode>> FSNode::getChildren() const {
+vector<NodePtr> FSNode::getChildren() const {
     if (!isDirectory()) return {};
-    return htree.getAllNodes();
+    return htree().getAllNodes();
+}
+
+void FSNode::appendChildren(vector<FSNode*>& result) const {
+    if (!isDirectory()) return;
+    htree().appendNodes(result);
 }
 
-uint32_t HashFunction::hash(const string& str) {
+uint32_t HashFunction::hash(string_view str) {
     uint32_t hash = 0;
     for (char c : str) {
         hash = hash * 31 + static_cast<uint32_t>(c);
@@ -56,15 +108,46 @@ uint32_t HashFunction::hash(const string& str) {
     return hash;
 }
 
-AVLHashNode::AVLHashNode(uint32_t h, const string& n, shared_ptr<FSNode> nd)
-    : hash(h), name(n), node(nd), left(nullptr), right(nullptr), height(1) {}
+AVLHashNode::AVLHashNode(uint32_t h, string_view n, uint32_t i)
+    : hash(h), name(n), ino(i), left(nullptr), right(nullptr), height(1) {}
 
-HTreeIndex::HTreeIndex() : root(nullptr), nodeCount(0) {}
+HTreeIndex::HTreeIndex(size_t inlineLimit, size_t btreeLimit) 
+    : table(nullptr), root(nullptr), nodeCount(0), inlineLimit(inlineLimit), btreeLimit(btreeLimit),
+      filterEnabled(true) {}
 
 HTreeIndex::~HTreeIndex() {
+    releaseAll();
     deleteTree(root);
 }
 
+string_view HTreeIndex::nameOf(uint32_t ino) const {
+    return table->at(ino)->name;
+}
+
+NodePtr HTreeIndex::handle(uint32_t ino) const {
+    return ino == InodeTable::NO_INODE ? nullptr : NodePtr(table->at(ino));
+}
+
+uint32_t HTreeIndex::adopt(const NodePtr& node) {
+    if (!table) {
+        table = node->inodeTable();
+    }
+    node->retain();
+    return node->ino;
+}
+
+void HTreeIndex::releaseAll() {
+    if (nodeCount == 0) return;
+    for (const auto& entry : sortedEntries()) {
+        FSNode* child = table->at(entry.ino);
+        {
+            WriteLock guard(table->lockOf(entry.ino));
+            child->parent = nullptr;
+        }
+        child->release();
+    }
+}
+
 int HTreeIndex::getHeight(AVLHashNode* n) const {
     return n ? n->height : 0;
 }
@@ -132,43 +215,55 @@ AVLHashNode* HTreeIndex::balance(AVLHashNode* node) {
     return node;
 }
 
-AVLHashNode* HTreeIndex::insertNode(AVLHashNode* node, uint32_t hash, 
-        const string& name, shared_ptr<FSNode> fsnode) {
-    if (!node) {
-        return new AVLHashNode(hash, name, fsnode);
-    }
+AVLHashNode* HTreeIndex::insertNode(AVLHashNode* node, uint32_t hash, string_view name, uint32_t ino) {
+    AVLHashNode* top = node;
+    AVLHashNode** path[MAX_HEIGHT];
+    int depth = 0;
+    AVLHashNode** link = &top;
 
-    if (hash < node->hash) {
-        node->left = insertNode(node->left, hash, name, fsnode);
-    } else if (hash > node->hash) {
-        node->right = insertNode(node->right, hash, name, fsnode);
-    } else {
-        if (name < node->name) {
-            node->left = insertNode(node->left, hash, name, fsnode);
+    while (*link) {
+        path[depth++] = link;
+        AVLHashNode* current = *link;
+        if (hash < current->hash || (hash == current->hash && name < current->name)) {
+            link = &current->left;
         } else {
-            node->right = insertNode(node->right, hash, name, fsnode);
+            link = &current->right;
         }
     }
+    *link = new AVLHashNode(hash, name, ino);
 
-    return balance(node);
+    rebalancePath(path, depth);
+    return top;
 }
 
-shared_ptr<FSNode> HTreeIndex::findNode(AVLHashNode* node, uint32_t hash, 
-        const string& name) const {
-    if (!node) return nullptr;
+void HTreeIndex::rebalancePath(AVLHashNode** path[], int depth) {
+    while (depth > 0) {
+        AVLHashNode** link = path[--depth];
+        int oldHeight = (*link)->height;
+        *link = balance(*link);
+        if ((*link)->height == oldHeight) {
+            break;
+        }
+    }
+}
 
-    if (hash < node->hash) {
-        return findNode(node->left, hash, name);
-    } else if (hash > node->hash) {
-        return findNode(node->right, hash, name);
-    } else {
-        if (node->name == name) {
-            return node->node;
+uint32_t HTreeIndex::findNode(AVLHashNode* node, uint32_t hash, string_view name) const {
+    while (node) {
+        __builtin_prefetch(node->left);
+        __builtin_prefetch(node->right);
+        if (hash < node->hash) {
+            node = node->left;
+        } else if (hash > node->hash) {
+            node = node->right;
+        } else {
+            int cmp = name.compare(node->name);
+            if (cmp == 0) {
+                return node->ino;
+            }
+            node = cmp < 0 ? node->left : node->right;
         }
-        auto left_result = findNode(node->left, hash, name);
-        if (left_result) return left_result;
-        return findNode(node->right, hash, name);
     }
+    return InodeTable::NO_INODE;
 }
 
 AVLHashNode* HTreeIndex::findMin(AVLHashNode* node) {
@@ -178,102 +273,796 @@ AVLHashNode* HTreeIndex::findMin(AVLHashNode* node) {
     return node;
 }
 
-pair<AVLHashNode*, bool> HTreeIndex::removeNode(AVLHashNode* node, uint32_t hash, const string& name) {
-    if (!node) return {nullptr, false};
-
-    bool removed = false;
-    if (hash < node->hash) {
-        auto [newLeft, wasRemoved] = removeNode(node->left, hash, name);
-        node->left = newLeft;
-        removed = wasRemoved;
-    } else if (hash > node->hash) {
-        auto [newRight, wasRemoved] = removeNode(node->right, hash, name);
-        node->right = newRight;
-        removed = wasRemoved;
-    } else if (node->name == name) {
-        removed = true;
-        if (!node->left || !node->right) {
-            AVLHashNode* temp = node->left ? node->left : node->right;
-            delete node;
-            return {temp, true};
+pair<AVLHashNode*, uint32_t> HTreeIndex::removeNode(AVLHashNode* node, uint32_t hash, string_view name) {
+    AVLHashNode* top = node;
+    AVLHashNode** path[MAX_HEIGHT];
+    int depth = 0;
+    AVLHashNode** link = &top;
+
+    while (*link) {
+        AVLHashNode* current = *link;
+        if (hash == current->hash && name == current->name) break;
+        path[depth++] = link;
+        if (hash < current->hash || (hash == current->hash && name < current->name)) {
+            link = &current->left;
         } else {
-            AVLHashNode* temp = findMin(node->right);
-            node->hash = temp->hash;
-            node->name = temp->name;
-            node->node = temp->node;
-            auto [newRight, wasRemoved] = removeNode(node->right, temp->hash, temp->name);
-            node->right = newRight;
+            link = &current->right;
         }
-    } else {
-        auto [newLeft, wasRemoved] = removeNode(node->left, hash, name);
-        if (wasRemoved) {
-            node->left = newLeft;
-            return {balance(node), true};
+    }
+    if (!*link) {
+        return {top, InodeTable::NO_INODE};
+    }
+
+    AVLHashNode* target = *link;
+    uint32_t removed = target->ino;
+    if (target->left && target->right) {
+        path[depth++] = link;
+        AVLHashNode** successorLink = &target->right;
+        while ((*successorLink)->left) {
+            path[depth++] = successorLink;
+            successorLink = &(*successorLink)->left;
         }
-        auto [newRight, wasRemoved2] = removeNode(node->right, hash, name);
-        node->right = newRight;
-        removed = wasRemoved2;
+        AVLHashNode* successor = *successorLink;
+        target->hash = successor->hash;
+        target->name = move(successor->name);
+        target->ino = successor->ino;
+        *successorLink = successor->right;
+        delete successor;
+    } else {
+        *link = target->left ? target->left : target->right;
+        delete target;
     }
 
-    return {balance(node), removed};
+    rebalancePath(path, depth);
+    return {top, removed};
 }
 
-void HTreeIndex::collectNodes(AVLHashNode* node, vector<shared_ptr<FSNode>>& result) const {
-    if (!node) return;
-    collectNodes(node->left, result);
-    result.push_back(node->node);
-    collectNodes(node->right, result);
+void HTreeIndex::pushLeftSpine(AVLHashNode* node, vector<AVLHashNode*>& stack) {
+    while (node) {
+        stack.push_back(node);
+        node = node->left;
+    }
+}
+
+void HTreeIndex::collectNodes(AVLHashNode* node, vector<NodePtr>& result) const {
+    vector<AVLHashNode*> stack;
+    pushLeftSpine(node, stack);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        result.push_back(handle(current->ino));
+        pushLeftSpine(current->right, stack);
+    }
+}
+
+void HTreeIndex::collectAfter(AVLHashNode* node, uint32_t hash, string_view name,
+        size_t limit, vector<NodePtr>& result) const {
+    vector<AVLHashNode*> stack;
+    while (node) {
+        if (node->hash > hash || (node->hash == hash && node->name > name)) {
+            stack.push_back(node);
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    while (!stack.empty() && result.size() < limit) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        result.push_back(handle(current->ino));
+        pushLeftSpine(current->right, stack);
+    }
 }
 
 int HTreeIndex::countNodes(AVLHashNode* node) const {
-    if (!node) return 0;
-    return 1 + countNodes(node->left) + countNodes(node->right);
+    int count = 0;
+    vector<AVLHashNode*> stack;
+    if (node) stack.push_back(node);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        count++;
+        if (current->left) stack.push_back(current->left);
+        if (current->right) stack.push_back(current->right);
+    }
+    return count;
 }
 
 void HTreeIndex::deleteTree(AVLHashNode* node) {
-    if (!node) return;
-    deleteTree(node->left);
-    deleteTree(node->right);
-    delete node;
+    vector<AVLHashNode*> stack;
+    if (node) stack.push_back(node);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        if (current->left) stack.push_back(current->left);
+        if (current->right) stack.push_back(current->right);
+        delete current;
+    }
 }
 
-void HTreeIndex::insert(const string& name, shared_ptr<FSNode> node) {
-    uint32_t hashValue = HashFunction::hash(name);
-    root = insertNode(root, hashValue, name, node);
+void HTreeIndex::insert(string_view name, const NodePtr& node) {
+    uint32_t hashValue = node->nameHash;
+    uint32_t ino = adopt(node);
+    if (frozen) {
+        thaw();
+    }
+    if (!btree && (size_t)nodeCount >= btreeLimit) {
+        toBTree();
+    }
+
+    if (btree) {
+        btree->insert(hashValue, ino);
+        if (filter) {
+            filter->add(hashValue);
+        }
+    } else if (!root && entries.size() < inlineLimit) {
+        entries.insert(entries.begin() + inlinePosition(hashValue, name), {hashValue, ino});
+    } else {
+        if (!root && !entries.empty()) {
+            promote();
+        }
+        root = insertNode(root, hashValue, node->name, ino);
+        if (filter) {
+            filter->add(hashValue);
+        }
+    }
     nodeCount++;
+    if (filter && (size_t)nodeCount > filter->getCapacity()) {
+        rebuildFilter();
+    }
+    if (nameOrder) {
+        nameOrder->insert(ino);
+    }
+#ifdef FS_CONCURRENT
+    published.insert(hashValue, ino);
+#endif
+}
+
+template <typename Entry, typename Less>
+static vector<Entry> mergeReplacing(const vector<Entry>& existing, const vector<Entry>& batch,
+        Less less, vector<Entry>& dropped) {
+    vector<Entry> merged;
+    merged.reserve(existing.size() + batch.size());
+    size_t i = 0;
+    for (size_t j = 0; j < batch.size(); j++) {
+        if (j + 1 < batch.size() && !less(batch[j], batch[j + 1])) {
+            dropped.push_back(batch[j]);
+            continue;
+        }
+        while (i < existing.size() && less(existing[i], batch[j])) {
+            merged.push_back(existing[i++]);
+        }
+        if (i < existing.size() && !less(batch[j], existing[i])) {
+            dropped.push_back(existing[i++]);
+        }
+        merged.push_back(batch[j]);
+    }
+    merged.insert(merged.end(), existing.begin() + i, existing.end());
+    return merged;
+}
+
+void HTreeIndex::bulkLoad(vector<NodePtr> items) {
+    if (items.empty()) return;
+    if (frozen) {
+        thaw();
+    }
+
+    if (isInline() && entries.size() + items.size() <= inlineLimit) {
+        for (auto& item : items) {
+            if (!replace(item)) {
+                insert(item->name, item);
+            }
+        }
+        return;
+    }
+
+    auto entryLess = [this](const InlineEntry& a, const InlineEntry& b) {
+        return a.hash < b.hash || (a.hash == b.hash && nameOf(a.ino) < nameOf(b.ino));
+    };
+
+    if (btree || nodeCount + items.size() > btreeLimit) {
+        vector<InlineEntry> batch;
+        batch.reserve(items.size());
+        for (auto& item : items) {
+            uint32_t hashValue = item->nameHash;
+            batch.push_back({hashValue, adopt(item)});
+        }
+        stable_sort(batch.begin(), batch.end(), entryLess);
+
+        vector<InlineEntry> dropped;
+        vector<InlineEntry> merged = mergeReplacing(sortedEntries(), batch, entryLess, dropped);
+
+        clearStorage();
+        nodeCount = merged.size();
+        btree = make_unique<BPlusTree>(table);
+        btree->build(merged);
+        nameOrder.reset();
+        rebuildFilter();
+#ifdef FS_CONCURRENT
+        published.assign(merged);
+#endif
+        for (const auto& entry : dropped) {
+            table->at(entry.ino)->release();
+        }
+        return;
+    }
+
+    vector<AVLHashNode*> batch;
+    batch.reserve(items.size());
+    for (auto& item : items) {
+        string_view name = item->name;
+        uint32_t hashValue = item->nameHash;
+        batch.push_back(new AVLHashNode(hashValue, name, adopt(item)));
+    }
+
+    auto keyLess = [](const AVLHashNode* a, const AVLHashNode* b) {
+        return a->hash < b->hash || (a->hash == b->hash && a->name < b->name);
+    };
+    stable_sort(batch.begin(), batch.end(), keyLess);
+
+    vector<AVLHashNode*> existing;
+    existing.reserve(nodeCount);
+    if (root) {
+        flattenTree(root, existing);
+    } else {
+        for (auto& entry : entries) {
+            existing.push_back(new AVLHashNode(entry.hash, nameOf(entry.ino), entry.ino));
+        }
+    }
+    vector<AVLHashNode*> dropped;
+    batch = mergeReplacing(existing, batch, keyLess, dropped);
+
+    entries.clear();
+    entries.shrink_to_fit();
+    nodeCount = batch.size();
+    root = linkBalanced(batch, 0, batch.size());
+    nameOrder.reset();
+    rebuildFilter();
+#ifdef FS_CONCURRENT
+    published.assign(sortedEntries());
+#endif
+    for (AVLHashNode* node : dropped) {
+        table->at(node->ino)->release();
+        delete node;
+    }
+}
+
+NodePtr HTreeIndex::find(string_view name) const {
+    return find(name, HashFunction::hash(name));
+}
+
+#ifdef FS_CONCURRENT
+NodePtr HTreeIndex::findPublished(string_view name, uint32_t hashValue) const {
+    vector<NodePtr> rejected;
+    EpochGuard guard;
+    while (true) {
+        const LookupSlots* slots = published.load();
+        if (!slots) return nullptr;
+        bool changed = false;
+        for (size_t i = slots->start(hashValue);; i = (i + 1) & slots->mask) {
+            uint64_t value = slots->slots[i].load(memory_order_acquire);
+            if (value == LookupTable::EMPTY) break;
+            uint32_t ino = LookupTable::inoOf(value);
+            if (LookupTable::hashOf(value) != hashValue || ino == LookupTable::TOMBSTONE) continue;
+            FSNode* node = table->at(ino);
+            if (!node->tryRetain()) continue;
+            NodePtr candidate(node, adopt_lock);
+            if (slots->slots[i].load(memory_order_acquire) != value) {
+                rejected.push_back(move(candidate));
+                changed = true;
+                break;
+            }
+            if (candidate->name == name) return candidate;
+            rejected.push_back(move(candidate));
+        }
+        if (!changed) return nullptr;
+    }
+}
+#endif
+
+NodePtr HTreeIndex::find(string_view name, uint32_t hashValue) const {
+#ifdef FS_CONCURRENT
+    return findPublished(name, hashValue);
+#else
+    if (isInline()) {
+        for (const auto& entry : entries) {
+            if (entry.hash > hashValue) break;
+            if (entry.hash == hashValue && nameOf(entry.ino) == name) {
+                return handle(entry.ino);
+            }
+        }
+        return nullptr;
+    }
+    if (filter && !filter->mayContain(hashValue)) {
+        return nullptr;
+    }
+    if (frozen) {
+        return handle(frozen->find(hashValue, name));
+    }
+    if (btree) {
+        return handle(btree->find(hashValue, name));
+    }
+    return handle(findNode(root, hashValue, name));
+#endif
 }
 
-shared_ptr<FSNode> HTreeIndex::find(const string& name) const {
-    uint32_t hashValue = HashFunction::hash(name);
-    return findNode(root, hashValue, name);
+vector<NodePtr> HTreeIndex::findMany(const vector<string>& names) const {
+    vector<NodePtr> result(names.size());
+    if (!root) {
+        for (size_t i = 0; i < names.size(); i++) {
+            result[i] = find(names[i]);
+        }
+        return result;
+    }
+
+    size_t lane[FIND_BATCH];
+    uint32_t hashes[FIND_BATCH];
+    AVLHashNode* cursor[FIND_BATCH];
+    for (size_t start = 0; start < names.size(); start += FIND_BATCH) {
+        int active = 0;
+        for (size_t i = start; i < names.size() && i < start + FIND_BATCH; i++) {
+            uint32_t hashValue = HashFunction::hash(names[i]);
+            if (filter && !filter->mayContain(hashValue)) continue;
+            lane[active] = i;
+            hashes[active] = hashValue;
+            cursor[active] = root;
+            active++;
+        }
+        while (active > 0) {
+            for (int j = 0; j < active; ) {
+                AVLHashNode* node = cursor[j];
+                const string& name = names[lane[j]];
+                int cmp = hashes[j] < node->hash ? -1 : hashes[j] > node->hash ? 1 : name.compare(node->name);
+                if (cmp == 0) {
+                    result[lane[j]] = handle(node->ino);
+                    node = nullptr;
+                } else {
+                    node = cmp < 0 ? node->left : node->right;
+                }
+                if (!node) {
+                    active--;
+                    lane[j] = lane[active];
+                    hashes[j] = hashes[active];
+                    cursor[j] = cursor[active];
+                    continue;
+                }
+                __builtin_prefetch(node);
+                cursor[j] = node;
+                j++;
+            }
+        }
+    }
+    return result;
 }
 
-bool HTreeIndex::remove(const string& name) {
-    uint32_t hashValue = HashFunction::hash(name);
-    auto [newRoot, removed] = removeNode(root, hashValue, name);
-    root = newRoot;
-    if (removed) {
+bool HTreeIndex::remove(string_view name) {
+    return remove(name, HashFunction::hash(name));
+}
+
+bool HTreeIndex::remove(string_view name, uint32_t hashValue) {
+    if (frozen) {
+        thaw();
+    }
+    uint32_t removed = InodeTable::NO_INODE;
+    if (btree) {
+        removed = btree->remove(hashValue, name);
+    } else if (!root) {
+        size_t pos = inlinePosition(hashValue, name);
+        if (pos < entries.size() && entries[pos].hash == hashValue && nameOf(entries[pos].ino) == name) {
+            removed = entries[pos].ino;
+            entries.erase(entries.begin() + pos);
+        }
+    } else {
+        auto [newRoot, removedIno] = removeNode(root, hashValue, name);
+        root = newRoot;
+        removed = removedIno;
+    }
+    if (removed != InodeTable::NO_INODE) {
         nodeCount--;
+        if (btree && (size_t)nodeCount <= btreeLimit / 4) {
+            vector<InlineEntry> sorted = sortedEntries();
+            rebuildFrom(sorted);
+        } else if (root && (size_t)nodeCount <= inlineLimit / 2) {
+            demote();
+        } else if (filter && (size_t)nodeCount < filter->getCapacity() / 8) {
+            rebuildFilter();
+        }
+        if (nameOrder) {
+            auto it = nameOrder->find(name);
+            if (it != nameOrder->end()) {
+                nameOrder->erase(it);
+            }
+        }
+#ifdef FS_CONCURRENT
+        published.erase(hashValue, removed);
+#endif
+        table->at(removed)->release();
+    }
+    return removed != InodeTable::NO_INODE;
+}
+
+bool HTreeIndex::replace(const NodePtr& node) {
+    if (frozen) {
+        thaw();
+    }
+    uint32_t hashValue = node->nameHash;
+    string_view name = node->name;
+    uint32_t previous = InodeTable::NO_INODE;
+    if (btree) {
+        previous = btree->replace(hashValue, name, node->ino);
+    } else if (!root) {
+        size_t pos = inlinePosition(hashValue, name);
+        if (pos < entries.size() && entries[pos].hash == hashValue && nameOf(entries[pos].ino) == name) {
+            previous = entries[pos].ino;
+            entries[pos].ino = node->ino;
+        }
+    } else {
+        for (AVLHashNode* current = root; current;) {
+            if (hashValue != current->hash) {
+                current = hashValue < current->hash ? current->left : current->right;
+                continue;
+            }
+            int cmp = name.compare(current->name);
+            if (cmp == 0) {
+                previous = current->ino;
+                current->ino = node->ino;
+                current->name = node->name;
+                break;
+            }
+            current = cmp < 0 ? current->left : current->right;
+        }
+    }
+    if (previous == InodeTable::NO_INODE) {
+        return false;
     }
-    return removed;
+    adopt(node);
+    if (nameOrder) {
+        auto it = nameOrder->find(name);
+        if (it != nameOrder->end()) {
+            nameOrder->erase(it);
+        }
+        nameOrder->insert(node->ino);
+    }
+#ifdef FS_CONCURRENT
+    published.replace(hashValue, previous, node->ino);
+#endif
+    table->at(previous)->release();
+    return true;
+}
+
+void HTreeIndex::addUsage(const Usage& delta) {
+    totals.add(delta);
 }
 
-vector<shared_ptr<FSNode>> HTreeIndex::getAllNodes() const {
-    vector<shared_ptr<FSNode>> result;
+Usage HTreeIndex::usage() const {
+    return totals.load();
+}
+
+void HTreeIndex::detachAll(vector<NodePtr>& result) {
+    if (nodeCount == 0) return;
+    for (const auto& entry : sortedEntries()) {
+        result.emplace_back(table->at(entry.ino), adopt_lock);
+    }
+    clearStorage();
+    nodeCount = 0;
+    nameOrder.reset();
+    rebuildFilter();
+#ifdef FS_CONCURRENT
+    published.assign({});
+#endif
+}
+
+vector<NodePtr> HTreeIndex::getAllNodes() const {
+    vector<NodePtr> result;
+    if (btree || frozen) {
+        vector<InlineEntry> all = sortedEntries();
+        result.reserve(all.size());
+        for (const auto& entry : all) {
+            result.push_back(handle(entry.ino));
+        }
+        return result;
+    }
+    for (const auto& entry : entries) {
+        result.push_back(handle(entry.ino));
+    }
     collectNodes(root, result);
     return result;
 }
 
+void HTreeIndex::appendNodes(vector<FSNode*>& result) const {
+    if (nodeCount == 0) return;
+    result.reserve(result.size() + nodeCount);
+    if (btree || frozen) {
+        for (const auto& entry : sortedEntries()) {
+            result.push_back(table->at(entry.ino));
+        }
+        return;
+    }
+    for (const auto& entry : entries) {
+        result.push_back(table->at(entry.ino));
+    }
+    vector<AVLHashNode*> stack;
+    pushLeftSpine(root, stack);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        result.push_back(table->at(current->ino));
+        pushLeftSpine(current->right, stack);
+    }
+}
+
+void HTreeIndex::collectEntries(AVLHashNode* node, vector<InlineEntry>& result) const {
+    vector<AVLHashNode*> stack;
+    pushLeftSpine(node, stack);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        result.push_back({current->hash, current->ino});
+        pushLeftSpine(current->right, stack);
+    }
+}
+
+void HTreeIndex::flattenTree(AVLHashNode* node, vector<AVLHashNode*>& result) const {
+    vector<AVLHashNode*> stack;
+    pushLeftSpine(node, stack);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        result.push_back(current);
+        pushLeftSpine(current->right, stack);
+    }
+}
+
+AVLHashNode* HTreeIndex::linkBalanced(const vector<AVLHashNode*>& sorted, int start, int end) {
+    if (start >= end) return nullptr;
+
+    int mid = start + (end - start) / 2;
+    AVLHashNode* node = sorted[mid];
+    node->left = linkBalanced(sorted, start, mid);
+    node->right = linkBalanced(sorted, mid + 1, end);
+    updateHeight(node);
+    return node;
+}
+
+size_t HTreeIndex::inlinePosition(uint32_t hash, string_view name) const {
+    size_t pos = 0;
+    while (pos < entries.size() && (entries[pos].hash < hash || 
+            (entries[pos].hash == hash && nameOf(entries[pos].ino) < name))) {
+        pos++;
+    }
+    return pos;
+}
+
+void HTreeIndex::promote() {
+    vector<AVLHashNode*> sorted;
+    sorted.reserve(entries.size());
+    for (auto& entry : entries) {
+        sorted.push_back(new AVLHashNode(entry.hash, nameOf(entry.ino), entry.ino));
+    }
+    root = linkBalanced(sorted, 0, sorted.size());
+    entries.clear();
+    entries.shrink_to_fit();
+    rebuildFilter();
+}
+
+void HTreeIndex::demote() {
+    entries.reserve(nodeCount);
+    collectEntries(root, entries);
+    deleteTree(root);
+    root = nullptr;
+    filter.reset();
+}
+
+vector<InlineEntry> HTreeIndex::sortedEntries() const {
+    vector<InlineEntry> result;
+    if (frozen) {
+        frozen->collectAll(result);
+    } else if (btree) {
+        btree->collectAll(result);
+    } else if (root) {
+        result.reserve(nodeCount);
+        collectEntries(root, result);
+    } else {
+        result = entries;
+    }
+    return result;
+}
+
+void HTreeIndex::clearStorage() {
+    deleteTree(root);
+    root = nullptr;
+    btree.reset();
+    frozen.reset();
+    entries.clear();
+    entries.shrink_to_fit();
+}
+
+void HTreeIndex::toBTree() {
+    vector<InlineEntry> sorted = sortedEntries();
+    clearStorage();
+    btree = make_unique<BPlusTree>(table);
+    btree->build(sorted);
+    rebuildFilter();
+}
+
+void HTreeIndex::rebuildFrom(vector<InlineEntry>& sorted) {
+    clearStorage();
+    if (sorted.size() > btreeLimit) {
+        btree = make_unique<BPlusTree>(table);
+        btree->build(sorted);
+    } else if (sorted.size() > inlineLimit) {
+        vector<AVLHashNode*> nodes;
+        nodes.reserve(sorted.size());
+        for (auto& entry : sorted) {
+            nodes.push_back(new AVLHashNode(entry.hash, nameOf(entry.ino), entry.ino));
+        }
+        root = linkBalanced(nodes, 0, nodes.size());
+    } else {
+        entries.swap(sorted);
+    }
+    rebuildFilter();
+}
+
+void HTreeIndex::thaw() {
+    vector<InlineEntry> sorted = sortedEntries();
+    rebuildFrom(sorted);
+}
+
+void HTreeIndex::freeze() {
+    if (frozen || isInline()) return;
+    vector<InlineEntry> sorted = sortedEntries();
+    clearStorage();
+    frozen = make_unique<FrozenIndex>(sorted, table);
+    rebuildFilter();
+}
+
+void HTreeIndex::fillFilter(AVLHashNode* node) {
+    vector<AVLHashNode*> stack;
+    if (node) stack.push_back(node);
+    while (!stack.empty()) {
+        AVLHashNode* current = stack.back();
+        stack.pop_back();
+        filter->add(current->hash);
+        if (current->left) stack.push_back(current->left);
+        if (current->right) stack.push_back(current->right);
+    }
+}
+
+void HTreeIndex::rebuildFilter() {
+    if (!filterEnabled || isInline()) {
+        filter.reset();
+        return;
+    }
+    if (!filter) {
+        filter = make_unique<BloomFilter>();
+    }
+    filter->reset(max<size_t>(nodeCount * 2, 64));
+    if (btree || frozen) {
+        vector<InlineEntry> all = sortedEntries();
+        for (const auto& entry : all) {
+            filter->add(entry.hash);
+        }
+    } else {
+        fillFilter(root);
+    }
+}
+
+bool HTreeIndex::NameLess::operator()(uint32_t a, uint32_t b) const {
+    return index->nameOf(a) < index->nameOf(b);
+}
+
+bool HTreeIndex::NameLess::operator()(uint32_t a, string_view b) const {
+    return index->nameOf(a) < b;
+}
+
+bool HTreeIndex::NameLess::operator()(string_view a, uint32_t b) const {
+    return a < index->nameOf(b);
+}
+
+void HTreeIndex::ensureNameOrder() const {
+    if (nameOrder) return;
+    nameOrder = make_unique<set<uint32_t, NameLess>>(NameLess{this});
+    for (const auto& entry : sortedEntries()) {
+        nameOrder->insert(entry.ino);
+    }
+}
+
+vector<NodePtr> HTreeIndex::lowerBound(const string& key, size_t limit) const {
+    vector<NodePtr> result;
+    ensureNameOrder();
+    for (auto it = nameOrder->lower_bound(string_view(key));
+            it != nameOrder->end() && result.size() < limit; ++it) {
+        result.push_back(handle(*it));
+    }
+    return result;
+}
+
+vector<NodePtr> HTreeIndex::prefixRange(const string& prefix, size_t limit) const {
+    vector<NodePtr> result;
+    ensureNameOrder();
+    for (auto it = nameOrder->lower_bound(string_view(prefix));
+            it != nameOrder->end() && result.size() < limit; ++it) {
+        if (nameOf(*it).compare(0, prefix.size(), prefix) != 0) break;
+        result.push_back(handle(*it));
+    }
+    return result;
+}
+
+vector<NodePtr> HTreeIndex::entriesAfter(uint32_t hash, string_view name, size_t limit) const {
+    vector<NodePtr> result;
+    if (frozen || btree) {
+        vector<uint32_t> inos;
+        if (frozen) {
+            frozen->collectAfter(hash, name, limit, inos);
+        } else {
+            btree->collectAfter(hash, name, limit, inos);
+        }
+        result.reserve(inos.size());
+        for (uint32_t ino : inos) {
+            result.push_back(handle(ino));
+        }
+        return result;
+    }
+    for (const auto& entry : entries) {
+        if (result.size() >= limit) break;
+        if (entry.hash > hash || (entry.hash == hash && nameOf(entry.ino) > name)) {
+            result.push_back(handle(entry.ino));
+        }
+    }
+    collectAfter(root, hash, name, limit, result);
+    return result;
+}
+
 size_t HTreeIndex::size() const {
     return nodeCount;
 }
 
 bool HTreeIndex::empty() const {
-    return root == nullptr;
+    return nodeCount == 0;
+}
+
+bool HTreeIndex::isInline() const {
+    return !root && !btree && !frozen;
+}
+
+bool HTreeIndex::isBTree() const {
+    return btree != nullptr;
+}
+
+bool HTreeIndex::isFrozen() const {
+    return frozen != nullptr;
+}
+
+void HTreeIndex::setFilterEnabled(bool enabled) {
+    filterEnabled = enabled;
+    rebuildFilter();
+}
+
+size_t HTreeIndex::filterMemoryUsage() const {
+    return filter ? filter->memoryUsage() : 0;
+}
+
+size_t HTreeIndex::nameOrderSize() const {
+    return nameOrder ? nameOrder->size() : 0;
 }
 
 void HTreeIndex::printStats() const {
-    if (!root) return;
+    if (frozen) {
+        cout << "  [Frozen Stats] Записей: " << frozen->size()
+            << ", Компактный массив (Eytzinger): " << frozen->memoryUsage() << " байт" << endl;
+        return;
+    }
+    if (btree) {
+        btree->printStats();
+        return;
+    }
+    if (!root) {
+        if (!entries.empty()) {
+            cout << "  [AVL H-Tree Stats] Встроенный массив: " << entries.size()
+                << " из " << inlineLimit << " записей" << endl;
+        }
+        return;
+    }
 
     int nodes = countNodes(root);
     int height = getHeight(root);
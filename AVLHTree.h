@@ -1,94 +1,272 @@
 #pragma once
 
 #include "Rope.h"
+#include "RefCount.h"
+#include "Usage.h"
+#include "BloomFilter.h"
+#include "BPlusTree.h"
+#include "FrozenIndex.h"
+#include "NameArena.h"
+#include "InodeTable.h"
+#include "LookupTable.h"
+#include "Epoch.h"
 #include <string>
+#include <string_view>
 #include <vector>
+#include <set>
 #include <memory>
+#include <variant>
+#include <atomic>
 #include <cstdint>
 
 using namespace std;
 
-enum class NodeType {
+enum class NodeType : uint8_t {
     DIRECTORY,
     FILE
 };
 
 struct Permissions {
-    int owner;
-    int group;
-    int others;
+    uint16_t owner : 3;
+    uint16_t group : 3;
+    uint16_t others : 3;
 
     Permissions();
+    uint16_t mode() const;
     string toRWX(int perm) const;
     string toString() const;
 };
 
 class FSNode;
 
+class NodePtr {
+    private:
+        FSNode* node;
+
+    public:
+        NodePtr() : node(nullptr) {}
+        NodePtr(nullptr_t) : node(nullptr) {}
+        explicit NodePtr(FSNode* node);
+        NodePtr(FSNode* node, adopt_lock_t) : node(node) {}
+        NodePtr(const NodePtr& other);
+        NodePtr(NodePtr&& other) noexcept : node(other.node) { other.node = nullptr; }
+        ~NodePtr();
+
+        NodePtr& operator=(NodePtr other) noexcept {
+            swap(node, other.node);
+            return *this;
+        }
+
+        FSNode* get() const { return node; }
+        FSNode* operator->() const { return node; }
+        FSNode& operator*() const { return *node; }
+        explicit operator bool() const { return node != nullptr; }
+        bool operator==(const NodePtr& other) const { return node == other.node; }
+        bool operator!=(const NodePtr& other) const { return node != other.node; }
+        bool operator==(nullptr_t) const { return node == nullptr; }
+        bool operator!=(nullptr_t) const { return node != nullptr; }
+};
+
 class HashFunction {
     public:
-        static uint32_t hash(const string& str);
+        static uint32_t hash(string_view str);
 };
 
 struct AVLHashNode {
     uint32_t hash;
-    string name;
-    shared_ptr<FSNode> node;
+    string_view name;
+    uint32_t ino;
     AVLHashNode* left;
     AVLHashNode* right;
     int height;
 
-    AVLHashNode(uint32_t h, const string& n, shared_ptr<FSNode> nd);
+    AVLHashNode(uint32_t h, string_view n, uint32_t i);
+};
+
+struct InlineEntry {
+    uint32_t hash;
+    uint32_t ino;
 };
 
 class HTreeIndex {
     private:
+        InodeTable* table;
         AVLHashNode* root;
         int nodeCount;
+        size_t inlineLimit;
+        size_t btreeLimit;
+        vector<InlineEntry> entries;
+        unique_ptr<BPlusTree> btree;
+        unique_ptr<FrozenIndex> frozen;
+        bool filterEnabled;
+        unique_ptr<BloomFilter> filter;
+        struct NameLess {
+            using is_transparent = void;
+            const HTreeIndex* index;
+            bool operator()(uint32_t a, uint32_t b) const;
+            bool operator()(uint32_t a, string_view b) const;
+            bool operator()(string_view a, uint32_t b) const;
+        };
+
+        mutable unique_ptr<set<uint32_t, NameLess>> nameOrder;
+        UsageCounter totals;
+#ifdef FS_CONCURRENT
+        LookupTable published;
+
+        NodePtr findPublished(string_view name, uint32_t hash) const;
+#endif
 
+        string_view nameOf(uint32_t ino) const;
+        NodePtr handle(uint32_t ino) const;
+        uint32_t adopt(const NodePtr& node);
+        void releaseAll();
         int getHeight(AVLHashNode* n) const;
         int getBalance(AVLHashNode* n) const;
         void updateHeight(AVLHashNode* n);
         AVLHashNode* rightRotate(AVLHashNode* y);
         AVLHashNode* leftRotate(AVLHashNode* x);
         AVLHashNode* balance(AVLHashNode* node);
-        AVLHashNode* insertNode(AVLHashNode* node, uint32_t hash, 
-                const string& name, shared_ptr<FSNode> fsnode);
-        shared_ptr<FSNode> findNode(AVLHashNode* node, uint32_t hash, 
-                const string& name) const;
+        void rebalancePath(AVLHashNode** path[], int depth);
+        static void pushLeftSpine(AVLHashNode* node, vector<AVLHashNode*>& stack);
+        AVLHashNode* insertNode(AVLHashNode* node, uint32_t hash, string_view name, uint32_t ino);
+        uint32_t findNode(AVLHashNode* node, uint32_t hash, string_view name) const;
         AVLHashNode* findMin(AVLHashNode* node);
-        pair<AVLHashNode*, bool> removeNode(AVLHashNode* node, uint32_t hash, const string& name);
-        void collectNodes(AVLHashNode* node, vector<shared_ptr<FSNode>>& result) const;
+        pair<AVLHashNode*, uint32_t> removeNode(AVLHashNode* node, uint32_t hash, string_view name);
+        void collectNodes(AVLHashNode* node, vector<NodePtr>& result) const;
         int countNodes(AVLHashNode* node) const;
         void deleteTree(AVLHashNode* node);
+        void ensureNameOrder() const;
+        void collectAfter(AVLHashNode* node, uint32_t hash, string_view name,
+                size_t limit, vector<NodePtr>& result) const;
+        void collectEntries(AVLHashNode* node, vector<InlineEntry>& result) const;
+        void flattenTree(AVLHashNode* node, vector<AVLHashNode*>& result) const;
+        AVLHashNode* linkBalanced(const vector<AVLHashNode*>& sorted, int start, int end);
+        size_t inlinePosition(uint32_t hash, string_view name) const;
+        void promote();
+        void demote();
+        vector<InlineEntry> sortedEntries() const;
+        void clearStorage();
+        void rebuildFrom(vector<InlineEntry>& sorted);
+        void toBTree();
+        void thaw();
+        void fillFilter(AVLHashNode* node);
+        void rebuildFilter();
 
     public:
-        HTreeIndex();
+        static constexpr size_t INLINE_LIMIT = 8;
+        static constexpr size_t BTREE_LIMIT = 65536;
+        static constexpr int MAX_HEIGHT = 64;
+        static constexpr size_t FIND_BATCH = 8;
+
+        explicit HTreeIndex(size_t inlineLimit = INLINE_LIMIT, size_t btreeLimit = BTREE_LIMIT);
         ~HTreeIndex();
+        HTreeIndex(const HTreeIndex&) = delete;
+        HTreeIndex& operator=(const HTreeIndex&) = delete;
 
-        void insert(const string& name, shared_ptr<FSNode> node);
-        shared_ptr<FSNode> find(const string& name) const;
-        bool remove(const string& name);
-        vector<shared_ptr<FSNode>> getAllNodes() const;
+        void insert(string_view name, const NodePtr& node);
+        void bulkLoad(vector<NodePtr> items);
+        NodePtr find(string_view name) const;
+        NodePtr find(string_view name, uint32_t hash) const;
+        vector<NodePtr> findMany(const vector<string>& names) const;
+        bool remove(string_view name);
+        bool remove(string_view name, uint32_t hash);
+        bool replace(const NodePtr& node);
+        void detachAll(vector<NodePtr>& result);
+        void addUsage(const Usage& delta);
+        Usage usage() const;
+        vector<NodePtr> getAllNodes() const;
+        void appendNodes(vector<FSNode*>& result) const;
+        vector<NodePtr> lowerBound(const string& key, size_t limit = SIZE_MAX) const;
+        vector<NodePtr> prefixRange(const string& prefix, size_t limit = SIZE_MAX) const;
+        vector<NodePtr> entriesAfter(uint32_t hash, string_view name, size_t limit) const;
         size_t size() const;
         bool empty() const;
+        bool isInline() const;
+        bool isBTree() const;
+        bool isFrozen() const;
+        void freeze();
+        void setFilterEnabled(bool enabled);
+        size_t filterMemoryUsage() const;
+        size_t nameOrderSize() const;
         void printStats() const;
 };
 
 class FSNode {
  public:
-     string name;
+     FSNode* parent;
+     uint32_t nameHash;
+     uint32_t ino;
      NodeType type;
      Permissions permissions;
-     Rope content;
-     HTreeIndex htree;
-     FSNode* parent;
-     
-     FSNode(const string& name, NodeType type, FSNode* parent = nullptr);
+     bool attached;
+
+ private:
+     RefCount refs;
+
+ public:
+     string_view name;
+
+ private:
+     InodeTable* table;
+     variant<Rope, unique_ptr<HTreeIndex>> payload;
+
+     friend class InodeTable;
+     FSNode(string_view name, NodeType type, FSNode* parent, InodeTable* table, uint32_t ino);
+
+ public:
+     static NodePtr create(string_view name, NodeType type, FSNode* parent = nullptr);
+     void retain();
+     bool tryRetain();
+     void release();
+     uint32_t useCount() const;
+     Usage usage() const;
+     InodeTable* inodeTable() const;
+     NodePtr parentHandle(string* currentName = nullptr) const;
      bool isDirectory() const;
      bool isFile() const;
-     shared_ptr<FSNode> findChild(const string& childName);
-     void addChild(shared_ptr<FSNode> child, bool silent = false);
-     bool removeChild(const string& childName);
-     vector<shared_ptr<FSNode>> getChildren() const;
-};
\ No newline at end of file
+     Rope& content();
+     const Rope& content() const;
+     HTreeIndex& htree();
+     const HTreeIndex& htree() const;
+     NodePtr findChild(string_view childName);
+     NodePtr findChild(string_view childName, uint32_t childHash);
+     void addChild(NodePtr child, bool silent = false);
+     bool removeChild(string_view childName);
+     bool removeChild(string_view childName, uint32_t childHash);
+     vector<NodePtr> getChildren() const;
+     void appendChildren(vector<FSNode*>& result) const;
+};
+
+inline FSNode* InodeTable::at(uint32_t ino) const {
+    return reinterpret_cast<FSNode*>(chunks[ino / CHUNK_SLOTS].get() + (ino % CHUNK_SLOTS) * sizeof(FSNode));
+}
+
+inline void FSNode::retain() {
+    refs.increment();
+}
+
+inline bool FSNode::tryRetain() {
+    return refs.incrementIfLive();
+}
+
+inline void FSNode::release() {
+    if (refs.decrement()) {
+        table->destroy(ino);
+    }
+}
+
+inline uint32_t FSNode::useCount() const {
+    return refs.load();
+}
+
+inline NodePtr::NodePtr(FSNode* node) : node(node) {
+    if (node) node->retain();
+}
+
+inline NodePtr::NodePtr(const NodePtr& other) : node(other.node) {
+    if (node) node->retain();
+}
+
+inline NodePtr::~NodePtr() {
+    if (node) node->release();
+}
\ No newline at end of file
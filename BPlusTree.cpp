@@ -0,0 +1,422 @@
+#include "BPlusTree.h"
+#include "AVLHTree.h"
+#include "InodeTable.h"
+#include <iostream>
+
+using namespace std;
+
+BPlusNode::BPlusNode(bool isLeaf) : leaf(isLeaf), count(0) {}
+
+BPlusLeaf::BPlusLeaf() : BPlusNode(true), prev(nullptr), next(nullptr) {}
+
+BPlusInner::BPlusInner() : BPlusNode(false) {}
+
+BPlusTree::BPlusTree(const InodeTable* table) : table(table), root(nullptr), entryCount(0) {}
+
+BPlusTree::~BPlusTree() {
+    deleteNode(root);
+}
+
+string_view BPlusTree::nameOf(uint32_t ino) const {
+    return table->at(ino)->name;
+}
+
+bool BPlusTree::keyLess(uint32_t h1, string_view n1, uint32_t h2, string_view n2) {
+    return h1 < h2 || (h1 == h2 && n1 < n2);
+}
+
+int BPlusTree::childIndex(const BPlusInner* inner, uint32_t hash, string_view name) const {
+    int lo = 0;
+    int hi = inner->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (keyLess(hash, name, inner->hashes[mid], inner->names[mid])) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+int BPlusTree::leafLowerBound(const BPlusLeaf* leaf, uint32_t hash, string_view name, bool& exact) const {
+    int lo = 0;
+    int hi = leaf->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (leaf->hashes[mid] < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    exact = false;
+    for (; lo < leaf->count && leaf->hashes[lo] == hash; lo++) {
+        int cmp = nameOf(leaf->inos[lo]).compare(name);
+        if (cmp >= 0) {
+            exact = cmp == 0;
+            break;
+        }
+    }
+    return lo;
+}
+
+const BPlusLeaf* BPlusTree::findLeaf(uint32_t hash, string_view name) const {
+    const BPlusNode* node = root;
+    while (node && !node->leaf) {
+        const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+        node = inner->children[childIndex(inner, hash, name)];
+    }
+    return static_cast<const BPlusLeaf*>(node);
+}
+
+const BPlusLeaf* BPlusTree::firstLeaf() const {
+    const BPlusNode* node = root;
+    while (node && !node->leaf) {
+        node = static_cast<const BPlusInner*>(node)->children[0];
+    }
+    return static_cast<const BPlusLeaf*>(node);
+}
+
+void BPlusTree::build(const vector<InlineEntry>& sorted) {
+    deleteNode(root);
+    root = nullptr;
+    entryCount = sorted.size();
+    if (sorted.empty()) return;
+
+    struct Child {
+        BPlusNode* node;
+        uint32_t hash;
+        string_view name;
+    };
+    vector<Child> level;
+
+    BPlusLeaf* prevLeaf = nullptr;
+    for (size_t i = 0; i < sorted.size(); i += BPlusLeaf::CAPACITY) {
+        BPlusLeaf* leaf = new BPlusLeaf();
+        size_t end = min(sorted.size(), i + BPlusLeaf::CAPACITY);
+        for (size_t j = i; j < end; j++) {
+            leaf->hashes[leaf->count] = sorted[j].hash;
+            leaf->inos[leaf->count] = sorted[j].ino;
+            leaf->count++;
+        }
+        leaf->prev = prevLeaf;
+        if (prevLeaf) prevLeaf->next = leaf;
+        prevLeaf = leaf;
+        level.push_back({leaf, leaf->hashes[0], nameOf(leaf->inos[0])});
+    }
+
+    while (level.size() > 1) {
+        vector<Child> parents;
+        for (size_t i = 0; i < level.size(); i += BPlusInner::CAPACITY) {
+            BPlusInner* inner = new BPlusInner();
+            size_t end = min(level.size(), i + BPlusInner::CAPACITY);
+            for (size_t j = i; j < end; j++) {
+                if (j > i) {
+                    inner->hashes[inner->count - 1] = level[j].hash;
+                    inner->names[inner->count - 1] = table->names().retain(level[j].name);
+                }
+                inner->children[inner->count++] = level[j].node;
+            }
+            parents.push_back({inner, level[i].hash, level[i].name});
+        }
+        level.swap(parents);
+    }
+
+    root = level[0].node;
+}
+
+bool BPlusTree::insertIntoLeaf(BPlusLeaf* leaf, uint32_t hash, uint32_t ino, Split& split) {
+    bool exact;
+    int pos = leafLowerBound(leaf, hash, nameOf(ino), exact);
+
+    if (leaf->count < BPlusLeaf::CAPACITY) {
+        for (int i = leaf->count; i > pos; i--) {
+            leaf->hashes[i] = leaf->hashes[i - 1];
+            leaf->inos[i] = leaf->inos[i - 1];
+        }
+        leaf->hashes[pos] = hash;
+        leaf->inos[pos] = ino;
+        leaf->count++;
+        return false;
+    }
+
+    BPlusLeaf* right = new BPlusLeaf();
+    int half = BPlusLeaf::CAPACITY / 2;
+    for (int i = half; i < leaf->count; i++) {
+        right->hashes[right->count] = leaf->hashes[i];
+        right->inos[right->count] = leaf->inos[i];
+        right->count++;
+    }
+    leaf->count = half;
+
+    right->next = leaf->next;
+    right->prev = leaf;
+    if (leaf->next) leaf->next->prev = right;
+    leaf->next = right;
+
+    Split unused;
+    if (pos <= half) {
+        insertIntoLeaf(leaf, hash, ino, unused);
+    } else {
+        insertIntoLeaf(right, hash, ino, unused);
+    }
+
+    split.right = right;
+    split.hash = right->hashes[0];
+    split.name = table->names().retain(nameOf(right->inos[0]));
+    return true;
+}
+
+bool BPlusTree::insertInto(BPlusNode* node, uint32_t hash, uint32_t ino, Split& split) {
+    if (node->leaf) {
+        return insertIntoLeaf(static_cast<BPlusLeaf*>(node), hash, ino, split);
+    }
+
+    BPlusInner* inner = static_cast<BPlusInner*>(node);
+    int idx = childIndex(inner, hash, nameOf(ino));
+    Split childSplit;
+    if (!insertInto(inner->children[idx], hash, ino, childSplit)) {
+        return false;
+    }
+
+    if (inner->count < BPlusInner::CAPACITY) {
+        for (int i = inner->count - 1; i > idx; i--) {
+            inner->hashes[i] = inner->hashes[i - 1];
+            inner->names[i] = move(inner->names[i - 1]);
+        }
+        for (int i = inner->count; i > idx + 1; i--) {
+            inner->children[i] = inner->children[i - 1];
+        }
+        inner->hashes[idx] = childSplit.hash;
+        inner->names[idx] = move(childSplit.name);
+        inner->children[idx + 1] = childSplit.right;
+        inner->count++;
+        return false;
+    }
+
+    vector<uint32_t> hashes(inner->hashes, inner->hashes + inner->count - 1);
+    vector<string_view> names(make_move_iterator(inner->names), make_move_iterator(inner->names + inner->count - 1));
+    vector<BPlusNode*> children(inner->children, inner->children + inner->count);
+    hashes.insert(hashes.begin() + idx, childSplit.hash);
+    names.insert(names.begin() + idx, move(childSplit.name));
+    children.insert(children.begin() + idx + 1, childSplit.right);
+
+    int half = children.size() / 2;
+    BPlusInner* right = new BPlusInner();
+
+    inner->count = 0;
+    for (int i = 0; i < half; i++) {
+        if (i > 0) {
+            inner->hashes[i - 1] = hashes[i - 1];
+            inner->names[i - 1] = move(names[i - 1]);
+        }
+        inner->children[inner->count++] = children[i];
+    }
+    for (size_t i = half; i < children.size(); i++) {
+        if (i > (size_t)half) {
+            right->hashes[right->count - 1] = hashes[i - 1];
+            right->names[right->count - 1] = move(names[i - 1]);
+        }
+        right->children[right->count++] = children[i];
+    }
+
+    split.right = right;
+    split.hash = hashes[half - 1];
+    split.name = move(names[half - 1]);
+    return true;
+}
+
+void BPlusTree::insert(uint32_t hash, uint32_t ino) {
+    entryCount++;
+    if (!root) {
+        BPlusLeaf* leaf = new BPlusLeaf();
+        leaf->hashes[0] = hash;
+        leaf->inos[0] = ino;
+        leaf->count = 1;
+        root = leaf;
+        return;
+    }
+
+    Split split;
+    if (insertInto(root, hash, ino, split)) {
+        BPlusInner* newRoot = new BPlusInner();
+        newRoot->children[0] = root;
+        newRoot->children[1] = split.right;
+        newRoot->hashes[0] = split.hash;
+        newRoot->names[0] = move(split.name);
+        newRoot->count = 2;
+        root = newRoot;
+    }
+}
+
+uint32_t BPlusTree::find(uint32_t hash, string_view name) const {
+    const BPlusLeaf* leaf = findLeaf(hash, name);
+    if (!leaf) return InodeTable::NO_INODE;
+
+    bool exact;
+    int pos = leafLowerBound(leaf, hash, name, exact);
+    if (exact) {
+        return leaf->inos[pos];
+    }
+    return InodeTable::NO_INODE;
+}
+
+uint32_t BPlusTree::replace(uint32_t hash, string_view name, uint32_t ino) {
+    BPlusLeaf* leaf = const_cast<BPlusLeaf*>(findLeaf(hash, name));
+    if (!leaf) return InodeTable::NO_INODE;
+
+    bool exact;
+    int pos = leafLowerBound(leaf, hash, name, exact);
+    if (exact) {
+        uint32_t previous = leaf->inos[pos];
+        leaf->inos[pos] = ino;
+        return previous;
+    }
+    return InodeTable::NO_INODE;
+}
+
+bool BPlusTree::removeFrom(BPlusNode* node, uint32_t hash, string_view name, uint32_t& removed) {
+    if (node->leaf) {
+        BPlusLeaf* leaf = static_cast<BPlusLeaf*>(node);
+        bool exact;
+        int pos = leafLowerBound(leaf, hash, name, exact);
+        if (!exact) {
+            return false;
+        }
+
+        removed = leaf->inos[pos];
+        for (int i = pos; i < leaf->count - 1; i++) {
+            leaf->hashes[i] = leaf->hashes[i + 1];
+            leaf->inos[i] = leaf->inos[i + 1];
+        }
+        leaf->count--;
+
+        if (leaf->count > 0) return false;
+        if (leaf->prev) leaf->prev->next = leaf->next;
+        if (leaf->next) leaf->next->prev = leaf->prev;
+        return true;
+    }
+
+    BPlusInner* inner = static_cast<BPlusInner*>(node);
+    int idx = childIndex(inner, hash, name);
+    if (!removeFrom(inner->children[idx], hash, name, removed)) {
+        return false;
+    }
+
+    deleteNode(inner->children[idx]);
+    int sep = idx > 0 ? idx - 1 : 0;
+    if (inner->count > 1) {
+        table->names().release(inner->names[sep]);
+    }
+    for (int i = sep; i < inner->count - 2; i++) {
+        inner->hashes[i] = inner->hashes[i + 1];
+        inner->names[i] = move(inner->names[i + 1]);
+    }
+    for (int i = idx; i < inner->count - 1; i++) {
+        inner->children[i] = inner->children[i + 1];
+    }
+    inner->count--;
+    return inner->count == 0;
+}
+
+uint32_t BPlusTree::remove(uint32_t hash, string_view name) {
+    uint32_t removed = InodeTable::NO_INODE;
+    if (!root) return removed;
+
+    if (removeFrom(root, hash, name, removed)) {
+        deleteNode(root);
+        root = nullptr;
+    }
+    while (root && !root->leaf && root->count == 1) {
+        BPlusInner* inner = static_cast<BPlusInner*>(root);
+        root = inner->children[0];
+        inner->count = 0;
+        delete inner;
+    }
+    if (removed != InodeTable::NO_INODE) {
+        entryCount--;
+    }
+    return removed;
+}
+
+void BPlusTree::collectAll(vector<InlineEntry>& result) const {
+    result.reserve(result.size() + entryCount);
+    for (const BPlusLeaf* leaf = firstLeaf(); leaf; leaf = leaf->next) {
+        for (int i = 0; i < leaf->count; i++) {
+            result.push_back({leaf->hashes[i], leaf->inos[i]});
+        }
+    }
+}
+
+void BPlusTree::collectAfter(uint32_t hash, string_view name, size_t limit,
+        vector<uint32_t>& result) const {
+    const BPlusLeaf* leaf = findLeaf(hash, name);
+    if (!leaf) return;
+
+    bool exact;
+    int pos = leafLowerBound(leaf, hash, name, exact);
+    if (exact) {
+        pos++;
+    }
+    for (; leaf && result.size() < limit; leaf = leaf->next, pos = 0) {
+        for (int i = pos; i < leaf->count && result.size() < limit; i++) {
+            result.push_back(leaf->inos[i]);
+        }
+    }
+}
+
+void BPlusTree::deleteNode(BPlusNode* node) {
+    if (!node) return;
+    if (node->leaf) {
+        delete static_cast<BPlusLeaf*>(node);
+        return;
+    }
+    BPlusInner* inner = static_cast<BPlusInner*>(node);
+    for (int i = 0; i < inner->count; i++) {
+        deleteNode(inner->children[i]);
+    }
+    for (int i = 0; i + 1 < inner->count; i++) {
+        table->names().release(inner->names[i]);
+    }
+    delete inner;
+}
+
+void BPlusTree::countNodes(const BPlusNode* node, size_t& leaves, size_t& inners) const {
+    if (!node) return;
+    if (node->leaf) {
+        leaves++;
+        return;
+    }
+    inners++;
+    const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+    for (int i = 0; i < inner->count; i++) {
+        countNodes(inner->children[i], leaves, inners);
+    }
+}
+
+size_t BPlusTree::size() const {
+    return entryCount;
+}
+
+int BPlusTree::height() const {
+    int h = 0;
+    for (const BPlusNode* node = root; node; h++) {
+        node = node->leaf ? nullptr : static_cast<const BPlusInner*>(node)->children[0];
+    }
+    return h;
+}
+
+void BPlusTree::printStats() const {
+    size_t leaves = 0;
+    size_t inners = 0;
+    countNodes(root, leaves, inners);
+
+    cout << "  [B+ Tree Stats] Записей: " << entryCount
+        << ", Высота: " << height()
+        << ", Листьев: " << leaves
+        << ", Внутренних узлов: " << inners
+        << ", Заполненность листьев: "
+        << (leaves ? 100 * entryCount / (leaves * BPlusLeaf::CAPACITY) : 0) << "%"
+        << endl;
+}
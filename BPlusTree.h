@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+using namespace std;
+
+class InodeTable;
+struct InlineEntry;
+
+struct BPlusNode {
+    bool leaf;
+    int count;
+
+    explicit BPlusNode(bool isLeaf);
+};
+
+struct BPlusLeaf : BPlusNode {
+    static constexpr int CAPACITY = 32;
+
+    uint32_t hashes[CAPACITY];
+    uint32_t inos[CAPACITY];
+    BPlusLeaf* prev;
+    BPlusLeaf* next;
+
+    BPlusLeaf();
+};
+
+struct BPlusInner : BPlusNode {
+    static constexpr int CAPACITY = 64;
+
+    uint32_t hashes[CAPACITY - 1];
+    BPlusNode* children[CAPACITY];
+    string_view names[CAPACITY - 1];
+
+    BPlusInner();
+};
+
+class BPlusTree {
+    private:
+        const InodeTable* table;
+        BPlusNode* root;
+        size_t entryCount;
+
+        struct Split {
+            BPlusNode* right;
+            uint32_t hash;
+            string_view name;
+        };
+
+        string_view nameOf(uint32_t ino) const;
+        static bool keyLess(uint32_t h1, string_view n1, uint32_t h2, string_view n2);
+        int childIndex(const BPlusInner* inner, uint32_t hash, string_view name) const;
+        int leafLowerBound(const BPlusLeaf* leaf, uint32_t hash, string_view name, bool& exact) const;
+        const BPlusLeaf* findLeaf(uint32_t hash, string_view name) const;
+        const BPlusLeaf* firstLeaf() const;
+        bool insertInto(BPlusNode* node, uint32_t hash, uint32_t ino, Split& split);
+        bool insertIntoLeaf(BPlusLeaf* leaf, uint32_t hash, uint32_t ino, Split& split);
+        bool removeFrom(BPlusNode* node, uint32_t hash, string_view name, uint32_t& removed);
+        void deleteNode(BPlusNode* node);
+        void countNodes(const BPlusNode* node, size_t& leaves, size_t& inners) const;
+
+    public:
+        explicit BPlusTree(const InodeTable* table);
+        ~BPlusTree();
+        BPlusTree(const BPlusTree&) = delete;
+        BPlusTree& operator=(const BPlusTree&) = delete;
+
+        void build(const vector<InlineEntry>& sorted);
+        void insert(uint32_t hash, uint32_t ino);
+        uint32_t find(uint32_t hash, string_view name) const;
+        uint32_t remove(uint32_t hash, string_view name);
+        uint32_t replace(uint32_t hash, string_view name, uint32_t ino);
+        void collectAll(vector<InlineEntry>& result) const;
+        void collectAfter(uint32_t hash, string_view name, size_t limit,
+                vector<uint32_t>& result) const;
+        size_t size() const;
+        int height() const;
+        void printStats() const;
+};
@@ -0,0 +1,50 @@
+#include "BloomFilter.h"
+
+using namespace std;
+
+BloomFilter::BloomFilter() : capacity(0) {}
+
+uint64_t BloomFilter::mix(uint32_t hash) {
+    uint64_t x = hash + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t BloomFilter::probeMask(uint64_t mixed) const {
+    uint64_t mask = 0;
+    for (int i = 0; i < PROBES; i++) {
+        mask |= 1ULL << ((mixed >> (i * 6)) & 63);
+    }
+    return mask;
+}
+
+void BloomFilter::reset(size_t expectedEntries) {
+    size_t wordCount = 1;
+    while (wordCount * 64 < expectedEntries * BITS_PER_ENTRY) {
+        wordCount *= 2;
+    }
+    vector<uint64_t>(wordCount, 0).swap(words);
+    capacity = expectedEntries;
+}
+
+void BloomFilter::add(uint32_t hash) {
+    if (words.empty()) return;
+    uint64_t mixed = mix(hash);
+    words[(mixed >> 36) & (words.size() - 1)] |= probeMask(mixed);
+}
+
+bool BloomFilter::mayContain(uint32_t hash) const {
+    if (words.empty()) return true;
+    uint64_t mixed = mix(hash);
+    uint64_t mask = probeMask(mixed);
+    return (words[(mixed >> 36) & (words.size() - 1)] & mask) == mask;
+}
+
+size_t BloomFilter::getCapacity() const {
+    return capacity;
+}
+
+size_t BloomFilter::memoryUsage() const {
+    return words.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+class BloomFilter {
+    private:
+        vector<uint64_t> words;
+        size_t capacity;
+
+        static uint64_t mix(uint32_t hash);
+        uint64_t probeMask(uint64_t mixed) const;
+
+    public:
+        static constexpr int BITS_PER_ENTRY = 16;
+        static constexpr int PROBES = 6;
+
+        BloomFilter();
+
+        void reset(size_t expectedEntries);
+        void add(uint32_t hash);
+        bool mayContain(uint32_t hash) const;
+        size_t getCapacity() const;
+        size_t memoryUsage() const;
+};
@@ -0,0 +1,90 @@
+#include "DentryCache.h"
+
+using namespace std;
+
+double DentryCacheStats::hitRate() const {
+    size_t lookups = hits + negativeHits + misses;
+    return lookups ? (double)(hits + negativeHits) / lookups : 0.0;
+}
+
+DentryCache::DentryCache(size_t capacity)
+    : capacity(capacity), enabled(true), hits(0), negativeHits(0), misses(0), invalidations(0) {}
+
+const InodeRef* DentryCache::find(const string& path) {
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        misses++;
+        return nullptr;
+    }
+    if (it->second.ino == InodeTable::NO_INODE) {
+        negativeHits++;
+    } else {
+        hits++;
+    }
+    return &it->second;
+}
+
+void DentryCache::insert(const string& path, InodeRef ref) {
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        it->second = ref;
+        return;
+    }
+    if (entries.size() >= capacity) {
+        clear();
+    }
+    it = entries.emplace(path, ref).first;
+    ordered.insert(it->first);
+}
+
+void DentryCache::erase(unordered_map<string, InodeRef>::iterator it) {
+    ordered.erase(it->first);
+    entries.erase(it);
+    invalidations++;
+}
+
+void DentryCache::invalidate(string_view path) {
+    if (entries.empty()) return;
+    if (path == "/") {
+        invalidations += entries.size();
+        clear();
+        return;
+    }
+
+    auto exact = entries.find(string(path));
+    if (exact != entries.end()) {
+        erase(exact);
+    }
+
+    string prefix = string(path) + '/';
+    auto it = ordered.lower_bound(prefix);
+    while (it != ordered.end() && it->compare(0, prefix.size(), prefix) == 0) {
+        string_view key = *it;
+        ++it;
+        erase(entries.find(string(key)));
+    }
+}
+
+void DentryCache::clear() {
+    ordered.clear();
+    entries.clear();
+}
+
+void DentryCache::setEnabled(bool value) {
+    enabled = value;
+    if (!enabled) {
+        clear();
+    }
+}
+
+bool DentryCache::isEnabled() const {
+    return enabled;
+}
+
+bool DentryCache::empty() const {
+    return entries.empty();
+}
+
+DentryCacheStats DentryCache::stats() const {
+    return {hits, negativeHits, misses, invalidations, entries.size()};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "InodeTable.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <set>
+#include <cstdint>
+
+using namespace std;
+
+struct DentryCacheStats {
+    size_t hits;
+    size_t negativeHits;
+    size_t misses;
+    size_t invalidations;
+    size_t entries;
+
+    double hitRate() const;
+};
+
+class DentryCache {
+    private:
+        unordered_map<string, InodeRef> entries;
+        set<string_view> ordered;
+        size_t capacity;
+        bool enabled;
+        size_t hits;
+        size_t negativeHits;
+        size_t misses;
+        size_t invalidations;
+
+        void erase(unordered_map<string, InodeRef>::iterator it);
+
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 65536;
+
+        explicit DentryCache(size_t capacity = DEFAULT_CAPACITY);
+
+        const InodeRef* find(const string& path);
+        void insert(const string& path, InodeRef ref);
+        void invalidate(string_view path);
+        void clear();
+        void setEnabled(bool value);
+        bool isEnabled() const;
+        bool empty() const;
+        DentryCacheStats stats() const;
+};
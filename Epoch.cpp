@@ -0,0 +1,166 @@
+#include "Epoch.h"
+
+#ifdef FS_CONCURRENT
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <thread>
+#endif
+
+using namespace std;
+
+#ifdef FS_CONCURRENT
+
+namespace {
+
+struct EpochRecord {
+    atomic<uint64_t> active{0};
+    int depth = 0;
+    bool used = true;
+};
+
+struct Retired {
+    uint64_t epoch;
+    void* owner;
+    uintptr_t arg;
+    EpochReclaimer::Reclaim reclaim;
+};
+
+struct EpochState {
+    atomic<uint64_t> global{1};
+    mutex lock;
+    vector<EpochRecord*> records;
+    deque<Retired> limbo;
+
+    bool tryAdvance() {
+        uint64_t current = global.load();
+        for (EpochRecord* record : records) {
+            uint64_t seen = record->active.load();
+            if (seen != 0 && seen != current) {
+                return false;
+            }
+        }
+        global.store(current + 1);
+        return true;
+    }
+};
+
+EpochState& state() {
+    static EpochState* shared = new EpochState();
+    return *shared;
+}
+
+struct RecordHolder {
+    EpochRecord* record = nullptr;
+
+    EpochRecord* get() {
+        if (!record) {
+            EpochState& s = state();
+            lock_guard<mutex> guard(s.lock);
+            for (EpochRecord* candidate : s.records) {
+                if (!candidate->used) {
+                    record = candidate;
+                    break;
+                }
+            }
+            if (!record) {
+                record = new EpochRecord();
+                s.records.push_back(record);
+            }
+            record->used = true;
+        }
+        return record;
+    }
+
+    ~RecordHolder() {
+        if (record) {
+            lock_guard<mutex> guard(state().lock);
+            record->active.store(0);
+            record->depth = 0;
+            record->used = false;
+        }
+    }
+};
+
+thread_local RecordHolder holder;
+
+}
+
+void EpochReclaimer::enter() {
+    EpochRecord* record = holder.get();
+    if (record->depth++ > 0) {
+        return;
+    }
+    atomic<uint64_t>& global = state().global;
+    uint64_t current;
+    do {
+        current = global.load();
+        record->active.store(current);
+    } while (global.load() != current);
+}
+
+void EpochReclaimer::exit() {
+    EpochRecord* record = holder.get();
+    if (--record->depth == 0) {
+        record->active.store(0);
+    }
+}
+
+void EpochReclaimer::retire(void* owner, uintptr_t arg, Reclaim reclaim) {
+    EpochState& s = state();
+    vector<Retired> ready;
+    {
+        lock_guard<mutex> guard(s.lock);
+        s.limbo.push_back({s.global.load(), owner, arg, reclaim});
+        for (int i = 0; i < 2 && s.tryAdvance(); i++) {}
+        uint64_t safe = s.global.load();
+        while (!s.limbo.empty() && s.limbo.front().epoch + 2 <= safe) {
+            ready.push_back(s.limbo.front());
+            s.limbo.pop_front();
+        }
+    }
+    for (const Retired& item : ready) {
+        item.reclaim(item.owner, item.arg);
+    }
+}
+
+void EpochReclaimer::discard(const void* owner) {
+    EpochState& s = state();
+    lock_guard<mutex> guard(s.lock);
+    for (Retired& item : s.limbo) {
+        if (item.owner == owner) {
+            item.reclaim = [](void*, uintptr_t) {};
+        }
+    }
+}
+
+void EpochReclaimer::synchronize() {
+    EpochState& s = state();
+    uint64_t target = s.global.load() + 2;
+    while (s.global.load() < target) {
+        {
+            lock_guard<mutex> guard(s.lock);
+            s.tryAdvance();
+        }
+        if (s.global.load() < target) {
+            this_thread::yield();
+        }
+    }
+}
+
+#else
+
+void EpochReclaimer::enter() {}
+
+void EpochReclaimer::exit() {}
+
+void EpochReclaimer::retire(void* owner, uintptr_t arg, Reclaim reclaim) {
+    reclaim(owner, arg);
+}
+
+void EpochReclaimer::discard(const void*) {}
+
+void EpochReclaimer::synchronize() {}
+
+#endif
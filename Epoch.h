@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+using namespace std;
+
+class EpochReclaimer {
+    public:
+        using Reclaim = void (*)(void* owner, uintptr_t arg);
+
+        static void enter();
+        static void exit();
+        static void retire(void* owner, uintptr_t arg, Reclaim reclaim);
+        static void discard(const void* owner);
+        static void synchronize();
+};
+
+class EpochGuard {
+    public:
+        EpochGuard() { EpochReclaimer::enter(); }
+        ~EpochGuard() { EpochReclaimer::exit(); }
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+};
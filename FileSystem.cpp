@@ -2,53 +2,291 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <thread>
 
 using namespace std;
 
-FileSystem::FileSystem() : debugMode(false) {
-    root = make_shared<FSNode>("", NodeType::DIRECTORY, nullptr);
+FileSystem::FileSystem() : inodes(&names), cacheEpoch(0), debugMode(false), walkThreads(1), reclaimer(inodes) {
+#ifdef FS_CONCURRENT
+    walkThreads = max(thread::hardware_concurrency(), 1u);
+#endif
+    root = inodes.create("", NodeType::DIRECTORY, nullptr);
     currentDir = root;
+#ifdef FS_CONCURRENT
+    dentries.setEnabled(false);
+#endif
     cout << "[ФС] Файловая система инициализирована" << endl;
 }
 
+FileSystem::~FileSystem() {
+    setCwd(nullptr);
+    vector<NodePtr> retained;
+    for (const auto& snap : snapshots) {
+        snap->takeNodes(retained);
+    }
+    for (auto& node : retained) {
+        reclaimer.defer(move(node));
+    }
+    reclaimer.defer(move(root));
+    reclaimer.drain();
+}
+
 void FileSystem::toggleDebug() {
     debugMode = !debugMode;
     cout << "Режим отладки: " << (debugMode ? "ВКЛ" : "ВЫКЛ") << endl;
 }
 
+void FileSystem::setWalkThreads(size_t threads) {
+    walkThreads = max<size_t>(threads, 1);
+}
+
 bool FileSystem::isDebugMode() const {
     return debugMode;
 }
 
-vector<string> FileSystem::splitPath(const string& path) const {
-    vector<string> components;
-    stringstream ss(path);
-    string component;
+Transaction FileSystem::beginTransaction() {
+    return Transaction(this);
+}
+
+void FileSystem::setPathCacheEnabled(bool enabled) {
+    WriteLock guard(cacheLock);
+    dentries.setEnabled(enabled);
+}
+
+DentryCacheStats FileSystem::pathCacheStats() const {
+    WriteLock guard(cacheLock);
+    return dentries.stats();
+}
+
+void FileSystem::printPathCacheStats() const {
+    DentryCacheStats stats = pathCacheStats();
+    cout << "Кэш путей: " << (dentries.isEnabled() ? "ВКЛ" : "ВЫКЛ")
+         << ", записей: " << stats.entries
+         << ", попаданий: " << stats.hits
+         << ", отрицательных попаданий: " << stats.negativeHits
+         << ", промахов: " << stats.misses
+         << ", инвалидаций: " << stats.invalidations
+         << ", доля попаданий: " << fixed << setprecision(1) << stats.hitRate() * 100 << "%"
+         << defaultfloat << endl;
+}
+
+PathIterator::PathIterator(string_view path) : path(path), next(0), current{}, valid(false) {
+    advance();
+}
 
-    while (getline(ss, component, '/' )) {
+void PathIterator::advance() {
+    valid = false;
+    while (next < path.size()) {
+        size_t end = path.find('/', next);
+        if (end == string_view::npos) {
+            end = path.size();
+        }
+        string_view component = path.substr(next, end - next);
+        next = end + 1;
         if (!component.empty() && component != ".") {
-            components.push_back(component);
+            current = {component, HashFunction::hash(component)};
+            valid = true;
+            return;
         }
-    
     }
+}
 
-    return components;
+bool PathIterator::done() const {
+    return !valid;
 }
 
-shared_ptr<FSNode> FileSystem::findNode(const string& path) {
-    if (path == "/" || path.empty()) {
-        return root;
+bool PathIterator::isLast() const {
+    PathIterator rest = *this;
+    ++rest;
+    return rest.done();
+}
+
+const PathComponent& PathIterator::operator*() const {
+    return current;
+}
+
+const PathComponent* PathIterator::operator->() const {
+    return &current;
+}
+
+PathIterator& PathIterator::operator++() {
+    advance();
+    return *this;
+}
+
+NodeMutex& FileSystem::lockOf(const NodePtr& node) const {
+    return inodes.lockOf(node->ino);
+}
+
+NodePtr FileSystem::cwd() const {
+    WriteLock guard(cwdLock);
+    return currentDir;
+}
+
+void FileSystem::setCwd(NodePtr dir) {
+    WriteLock guard(cwdLock);
+    swap(currentDir, dir);
+    guard.unlock();
+    reclaimer.defer(move(dir));
+}
+
+bool FileSystem::isMountEntry(const NodePtr& parent, string_view name) const {
+    return parent == root && name == Snapshot::MOUNT;
+}
+
+NodePtr FileSystem::createChild(const NodePtr& parent, const PathComponent& comp, NodeType type,
+                                const string& content, bool silent) {
+    if (isMountEntry(parent, comp.name)) {
+        return nullptr;
+    }
+    reclaimer.poll();
+    WriteLock guard(lockOf(parent));
+    if (parent->findChild(comp.name, comp.hash)) {
+        return nullptr;
+    }
+    auto child = inodes.create(comp.name, type, parent.get());
+    if (!content.empty()) {
+        child->content() = Rope(content);
+    }
+    Usage added = child->usage();
+    preserve(parent, comp.name, comp.hash, nullptr);
+    parent->addChild(child, silent);
+    inodes.bumpVersion(parent->ino);
+    guard.unlock();
+    account(parent, added);
+    invalidatePath(child.get());
+    return child;
+}
+
+bool FileSystem::linkChild(const NodePtr& parent, const NodePtr& child) {
+    if (isMountEntry(parent, child->name)) {
+        return false;
     }
+    WriteLock guard(lockOf(parent));
+    if (parent->findChild(child->name, child->nameHash)) {
+        return false;
+    }
+    Usage added = child->usage();
+    preserve(parent, child->name, child->nameHash, nullptr);
+    parent->addChild(child, true);
+    inodes.bumpVersion(parent->ino);
+    guard.unlock();
+    account(parent, added);
+    invalidatePath(child.get());
+    return true;
+}
 
-    vector<string> components = splitPath(path);
-    shared_ptr<FSNode> current = root;
+bool FileSystem::unlinkChild(const NodePtr& parent, const NodePtr& child) {
+    reclaimer.poll();
+    WriteLock guard(lockOf(parent));
+    if (parent->findChild(child->name, child->nameHash) != child) {
+        return false;
+    }
+    preserve(parent, child->name, child->nameHash, child);
+    parent->removeChild(child->name, child->nameHash);
+    inodes.bumpVersion(parent->ino);
+    guard.unlock();
+    Usage removed;
+    {
+        WriteLock childGuard(lockOf(child));
+        removed = detachUsage(child);
+    }
+    account(parent, -removed);
+    invalidatePath(child.get());
+    return true;
+}
 
-    for (const auto& comp : components) {
+vector<NodePtr> FileSystem::childrenOf(const NodePtr& dir) const {
+    ReadLock guard(lockOf(dir));
+    return dir->getChildren();
+}
+
+string FileSystem::nameOf(const NodePtr& node) const {
+    ReadLock guard(lockOf(node));
+    return string(node->name);
+}
+
+int FileSystem::contentLength(const NodePtr& file) const {
+    ReadLock guard(lockOf(file));
+    return file->content().length();
+}
+
+void FileSystem::preserve(const NodePtr& node) {
+    if (snapshots.empty()) return;
+    uint32_t birth = inodes.birthOf(node->ino);
+    WriteLock guard(snapshotLock);
+    for (const auto& snap : snapshots) {
+        if (snap->covers(birth)) {
+            snap->preserve(node.get());
+        }
+    }
+}
+
+void FileSystem::preserve(const NodePtr& dir, string_view name, uint32_t hash, const NodePtr& previous) {
+    if (snapshots.empty()) return;
+    uint32_t birth = inodes.birthOf(dir->ino);
+    WriteLock guard(snapshotLock);
+    for (const auto& snap : snapshots) {
+        if (snap->covers(birth)) {
+            snap->preserve(dir.get(), name, hash, previous);
+        }
+    }
+}
+
+NodePtr FileSystem::usageParent(const NodePtr& node) const {
+    FSNode* up = node->attached ? node->parent : nullptr;
+    return up && up->tryRetain() ? NodePtr(up, adopt_lock) : nullptr;
+}
+
+void FileSystem::account(NodePtr dir, const Usage& delta) {
+    if (delta.empty()) return;
+    while (dir) {
+        NodePtr up;
+        {
+            ReadLock guard(lockOf(dir));
+            dir->htree().addUsage(delta);
+            up = usageParent(dir);
+        }
+        dir = move(up);
+    }
+}
+
+void FileSystem::accountResize(const NodePtr& file, int before, WriteLock& guard) {
+    Usage delta{file->content().length() - before, 0, 0};
+    NodePtr up = usageParent(file);
+    guard.unlock();
+    account(move(up), delta);
+}
+
+Usage FileSystem::detachUsage(const NodePtr& node) {
+    node->attached = false;
+    return node->usage();
+}
+
+NodePtr FileSystem::step(const NodePtr& current, const PathComponent& comp) {
+    if (comp.name != "..") {
+        return current->findChild(comp.name, comp.hash);
+    }
+    NodePtr parent = current->parentHandle();
+    return parent ? parent : current;
+}
+
+NodePtr FileSystem::walk(NodePtr current, string_view path, PathComponent* leaf) {
+    PathIterator it(path);
+    if (leaf && it.done()) {
+        return nullptr;
+    }
+
+    for (; !it.done(); ++it) {
         if (!current->isDirectory()) {
             return nullptr;
         }
-
-        current = current->findChild(comp);
+        if (leaf && it.isLast()) {
+            *leaf = *it;
+            return leaf->name == ".." ? nullptr : current;
+        }
+        current = step(current, *it);
         if (!current) {
             return nullptr;
         }
@@ -57,147 +295,167 @@ shared_ptr<FSNode> FileSystem::findNode(const string& path) {
     return current;
 }
 
-shared_ptr<FSNode> FileSystem::resolvePath(const string& path) {
-    if (path.empty()) {
+NodePtr FileSystem::walkCached(string_view path, PathComponent* leaf) {
+    static thread_local string pathKey;
+    PathIterator it(path);
+    if (leaf && it.done()) {
         return nullptr;
     }
-    
-    if (path[0] == '/') {
-        return findNode(path);
+
+    pathKey.clear();
+    for (; !it.done(); ++it) {
+        if (it->name == "..") {
+            return walk(root, path, leaf);
+        }
+        if (leaf && it.isLast()) {
+            *leaf = *it;
+            break;
+        }
+        pathKey += '/';
+        pathKey += it->name;
     }
-    
-    vector<string> components;
-    stringstream ss(path);
-    string component;
-    while (getline(ss, component, '/')) {
-        if (!component.empty()) {
-            components.push_back(component);
+    if (pathKey.empty()) {
+        return root;
+    }
+
+    InodeRef ref{InodeTable::NO_INODE, 0};
+    bool hit = false;
+    uint64_t epoch;
+    {
+        WriteLock guard(cacheLock);
+        if (const InodeRef* cachedRef = dentries.find(pathKey)) {
+            ref = *cachedRef;
+            hit = true;
         }
+        epoch = cacheEpoch;
     }
-    
-    shared_ptr<FSNode> current = currentDir;
-    for (const auto& comp : components) {
-        if (!current->isDirectory()) {
+    if (hit) {
+        if (ref.ino == InodeTable::NO_INODE) {
             return nullptr;
         }
-        
-        if (comp == "..") {
-            if (!current->parent) {
-                continue;
-            }
-            
-            FSNode* parentRaw = current->parent;
-            
-            if (parentRaw == root.get()) {
-                current = root;
-            } else {
-                string currentPath = getPathToNode(current);
-                size_t lastSlash = currentPath.find_last_of('/');
-                
-                if (lastSlash == 0) {
-                    current = root;
-                } else {
-                    string parentPath = currentPath.substr(0, lastSlash);
-                    current = findNode(parentPath);
-                    
-                    if (!current) {
-                        return nullptr;
-                    }
-                }
-            }
-        } else if (comp == ".") {
-            continue;
-        } else {
-            current = current->findChild(comp);
-            if (!current) {
-                return nullptr;
-            }
+        NodePtr cached = inodes.resolve(ref);
+        if (cached && (!leaf || cached->isDirectory())) {
+            return cached;
         }
     }
-    
-    return current;
-}
 
-string FileSystem::getPathToNode(shared_ptr<FSNode> node) {
-    if (node == root) {
-        return "/";
+    NodePtr node = walk(root, pathKey, nullptr);
+    ref = node ? inodes.ref(node.get()) : InodeRef{InodeTable::NO_INODE, 0};
+    {
+        WriteLock guard(cacheLock);
+        if (epoch == cacheEpoch) {
+            dentries.insert(pathKey, ref);
+        }
     }
-    
+    if (leaf && node && !node->isDirectory()) {
+        return nullptr;
+    }
+    return node;
+}
+
+string FileSystem::pathOf(const FSNode* node) const {
     vector<string> components;
-    FSNode* current = node.get();
-    
-    while (current && current != root.get()) {
-        components.push_back(current->name);
-        current = current->parent;
+    string name;
+    NodePtr current;
+    for (NodePtr up = node ? node->parentHandle(&name) : nullptr; up; up = up->parentHandle(&name)) {
+        components.push_back(move(name));
+        current = up;
     }
-    
-    string path = "";
+    if (components.empty()) {
+        return "/";
+    }
+
+    string path;
     for (auto it = components.rbegin(); it != components.rend(); ++it) {
-        path += "/" + *it;
+        path += '/';
+        path += *it;
     }
-    
     return path;
 }
 
-bool FileSystem::checkReadPermission(shared_ptr<FSNode> node) {
+void FileSystem::invalidatePath(const FSNode* node) {
+    WriteLock guard(cacheLock);
+    cacheEpoch++;
+    if (dentries.empty()) return;
+    dentries.invalidate(pathOf(node));
+}
+
+void FileSystem::invalidatePath(string_view path) {
+    WriteLock guard(cacheLock);
+    cacheEpoch++;
+    dentries.invalidate(path);
+}
+
+NodePtr FileSystem::findNode(string_view path) {
+    if (dentries.isEnabled()) {
+        return walkCached(path, nullptr);
+    }
+    return walk(root, path, nullptr);
+}
+
+NodePtr FileSystem::resolvePath(string_view path) {
+    if (path.empty()) {
+        return nullptr;
+    }
+    return walk(path[0] == '/' ? root : cwd(), path, nullptr);
+}
+
+NodePtr FileSystem::resolveParent(string_view path, PathComponent& leaf) {
+    if (path.empty()) {
+        return nullptr;
+    }
+    if (path[0] == '/' && dentries.isEnabled()) {
+        return walkCached(path, &leaf);
+    }
+    return walk(path[0] == '/' ? root : cwd(), path, &leaf);
+}
+
+bool FileSystem::checkReadPermission(const NodePtr& node) {
     if (!node) return false;
+    ReadLock guard(lockOf(node));
     return (node->permissions.owner & 4) != 0;
 }
 
-bool FileSystem::checkWritePermission(shared_ptr<FSNode> node) {
+bool FileSystem::checkWritePermission(const NodePtr& node) {
     if (!node) return false;
+    ReadLock guard(lockOf(node));
     return (node->permissions.owner & 2) != 0;
 }
 
-bool FileSystem::checkExecutePermission(shared_ptr<FSNode> node) {
+bool FileSystem::checkExecutePermission(const NodePtr& node) {
     if (!node) return false;
+    ReadLock guard(lockOf(node));
     return (node->permissions.owner & 1) != 0;
 }
 
-void FileSystem::searchRecursive(shared_ptr<FSNode> node, const string& name, 
-                    const string& currentPath, vector<string>& results) {
-    if (!node) return;
-    
-    string nodePath;
-    if (currentPath == "/") {
-        nodePath = "/" + node->name;
-    } else {
-        nodePath = currentPath + "/" + node->name;
-    }
-    
-    if (node->name.find(name) != string::npos) {
-        results.push_back(nodePath);
-    }
-    
-    if (node->isDirectory()) {
-        auto children = node->getChildren();
-        for (auto& child : children) {
-            searchRecursive(child, name, nodePath, results);
-        }
-    }
+vector<string> FileSystem::searchTree(const NodePtr& start, const string& prefix, const string& name) const {
+    TreeWalker walker(inodes, walkThreads);
+    return walker.collect(start, prefix, [&name](string_view candidate) {
+        return candidate.find(name) != string_view::npos;
+    });
 }
 
-void FileSystem::visualizeTree(shared_ptr<FSNode> node, const string& prefix, bool isLast) {
+void FileSystem::visualizeTree(const NodePtr& node, const string& prefix, bool isLast) {
     if (!node) return;
     
     cout << prefix;
     cout << (isLast ? "└── " : "├── ");
     
     if (node->isDirectory()) {
-        cout << "\033[1;34m" << node->name << "/\033[0m";
+        cout << "\033[1;34m" << nameOf(node) << "/\033[0m";
     } else {
-        cout << node->name;
+        cout << nameOf(node);
     }
     
     cout << " [" << node->permissions.toString() << "]";
     
-    cout << " {hash:" << HashFunction::hash(node->name) << "}";
+    cout << " {hash:" << node->nameHash << "}";
     
     cout << endl;
     
     if (node->isDirectory()) {
         string newPrefix = prefix + (isLast ? "    " : "│   ");
-        auto children = node->getChildren();
+        auto children = childrenOf(node);
         for (size_t i = 0; i < children.size(); i++) {
             bool childIsLast = (i == children.size() - 1);
             visualizeTree(children[i], newPrefix, childIsLast);
@@ -206,343 +464,984 @@ void FileSystem::visualizeTree(shared_ptr<FSNode> node, const string& prefix, bo
 }
 
 string FileSystem::getCurrentPath() const {
-    if (currentDir == root) return "/";
-    
-    string path;
-    FSNode* node = currentDir.get();
-    
-    while (node && node->parent) {
-        path = "/" + node->name + path;
-        node = node->parent;
-    }
-    
-    return path.empty() ? "/" : path;
+    NodePtr dir = cwd();
+    return pathOf(dir.get());
 }
 
 bool FileSystem::changeDirectory(const string& path) {
     if (path == "/") {
-        currentDir = root;
+        setCwd(root);
         return true;
     }
     
-    shared_ptr<FSNode> target;
+    NodePtr target;
     
     if (path[0] == '/') {
         target = findNode(path);
     } else if (path == "..") {
-        if (!currentDir->parent) {
+        NodePtr parent = cwd()->parentHandle();
+        if (parent) {
+            setCwd(parent);
+        }
+        return true;
+    } else {
+        target = resolvePath(path);
+    }
+    
+    if (!target) {
+        cout << "cd: " << path << ": Нет такого файла или каталога" << endl;
+        return false;
+    }
+    
+    if (!target->isDirectory()) {
+        cout << "cd: " << path << ": Это не каталог" << endl;
+        return false;
+    }
+    
+    if (!checkExecutePermission(target)) {
+        cout << "cd: " << path << ": Отказано в доступе" << endl;
+        return false;
+    }
+    
+    setCwd(target);
+    return true;
+}
+
+bool FileSystem::mkdir(const string& name) {
+    if (name.empty()) {
+        cout << "mkdir: отсутствует операнд" << endl;
+        return false;
+    }
+    
+    if (name.find('/') != string::npos) {
+        bool result = createDirectory(name, !debugMode);
+        if (!result) {
+            cout << "mkdir: невозможно создать каталог '" << name << "': Отказано в доступе" << endl;
+        }
+        return result;
+    }
+    
+    NodePtr dir = cwd();
+    if (!checkWritePermission(dir)) {
+        cout << "mkdir: невозможно создать каталог '" << name << "': Отказано в доступе" << endl;
+        return false;
+    }
+    
+    if (!createChild(dir, {name, HashFunction::hash(name)}, NodeType::DIRECTORY, "", !debugMode)) {
+        cout << "mkdir: невозможно создать каталог '" << name << "': Файл существует" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool FileSystem::touch(const string& name) {
+    if (name.empty()) {
+        cout << "touch: отсутствует операнд" << endl;
+        return false;
+    }
+    
+    if (isSnapshotPath(name)) {
+        cout << "touch: невозможно создать '" << name << "': Файловая система только для чтения" << endl;
+        return false;
+    }
+    
+    if (name.find('/') != string::npos) {
+        bool result = createFile(name, "", !debugMode);
+        if (!result) {
+            cout << "touch: невозможно создать '" << name << "': Отказано в доступе" << endl;
+        }
+        return result;
+    }
+    
+    NodePtr dir = cwd();
+    PathComponent comp{name, HashFunction::hash(name)};
+    if (isMountEntry(dir, comp.name)) {
+        cout << "touch: невозможно создать '" << name << "': Файловая система только для чтения" << endl;
+        return false;
+    }
+    if (step(dir, comp)) {
+        return true;
+    }
+    
+    if (!checkWritePermission(dir)) {
+        cout << "touch: невозможно создать файл '" << name << "': Отказано в доступе" << endl;
+        return false;
+    }
+    
+    if (!createChild(dir, comp, NodeType::FILE, "", !debugMode) && !step(dir, comp)) {
+        cout << "touch: невозможно создать файл '" << name << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    return true;
+}
+
+void FileSystem::cat(const string& name) {
+    if (isSnapshotPath(name)) {
+        shared_ptr<Snapshot> snap;
+        auto file = snapshotWalk(name, snap);
+        if (!file) {
+            cout << "cat: " << name << ": Нет такого файла или каталога" << endl;
+            return;
+        }
+        if (!file->isFile()) {
+            cout << "cat: " << name << ": Это каталог" << endl;
+            return;
+        }
+        NodeView view = snapshotView(*snap, file);
+        if (!(view.permissions.owner & 4)) {
+            cout << "cat: " << name << ": Отказано в доступе" << endl;
+            return;
+        }
+        cout << view.content.toString();
+        return;
+    }
+
+    auto file = resolvePath(name);
+    
+    if (!file) {
+        cout << "cat: " << name << ": Нет такого файла или каталога" << endl;
+        return;
+    }
+    
+    if (!file->isFile()) {
+        cout << "cat: " << name << ": Это каталог" << endl;
+        return;
+    }
+    
+    if (!checkReadPermission(file)) {
+        cout << "cat: " << name << ": Отказано в доступе" << endl;
+        return;
+    }
+    
+    ReadLock guard(lockOf(file));
+    cout << file->content().toString();
+}
+
+bool FileSystem::writeFile(const string& name, const string& content) {
+    if (isSnapshotPath(name)) {
+        cout << "Ошибка: " << name << ": Файловая система только для чтения" << endl;
+        return false;
+    }
+    
+    PathComponent leaf;
+    auto parent = resolveParent(name, leaf);
+    if (!parent) {
+        cout << "Ошибка: Путь не существует" << endl;
+        return false;
+    }
+    if (isMountEntry(parent, leaf.name)) {
+        cout << "Ошибка: " << name << ": Файловая система только для чтения" << endl;
+        return false;
+    }
+    
+    NodePtr file;
+    for (int attempt = 0; !(file = step(parent, leaf)); ++attempt) {
+        if (attempt == CREATE_ATTEMPTS) {
+            cout << "Ошибка: " << name << ": Не удалось создать файл" << endl;
+            return false;
+        }
+        if (createChild(parent, leaf, NodeType::FILE, content, !debugMode)) {
             return true;
         }
-        
-        FSNode* parentRaw = currentDir->parent;
-        
-        if (parentRaw == root.get()) {
-            currentDir = root;
+    }
+    
+    if (!file->isFile()) {
+        cout << "Ошибка: " << name << " является каталогом" << endl;
+        return false;
+    }
+    
+    if (!checkWritePermission(file)) {
+        cout << "Ошибка: " << name << ": Отказано в доступе" << endl;
+        return false;
+    }
+    
+    WriteLock guard(lockOf(file));
+    preserve(file);
+    int before = file->content().length();
+    file->content() = Rope(content);
+    inodes.bumpVersion(file->ino);
+    accountResize(file, before, guard);
+    return true;
+}
+
+bool FileSystem::appendFile(const string& name, const string& content) {
+    if (isSnapshotPath(name)) {
+        cout << "Ошибка: " << name << ": Файловая система только для чтения" << endl;
+        return false;
+    }
+    
+    auto file = resolvePath(name);
+    
+    if (!file) {
+        return writeFile(name, content);
+    }
+    
+    if (!file->isFile()) {
+        cout << "Ошибка: " << name << " является каталогом" << endl;
+        return false;
+    }
+    
+    if (!checkWritePermission(file)) {
+        cout << "Ошибка: " << name << ": Отказано в доступе" << endl;
+        return false;
+    }
+    
+    WriteLock guard(lockOf(file));
+    preserve(file);
+    int before = file->content().length();
+    file->content().append(content);
+    inodes.bumpVersion(file->ino);
+    accountResize(file, before, guard);
+    return true;
+}
+
+bool FileSystem::rm(const string& name, bool recursive) {
+    PathComponent leaf;
+    auto parent = resolveParent(name, leaf);
+    auto target = parent ? step(parent, leaf) : nullptr;
+    
+    if (!target) {
+        cout << "rm: невозможно удалить '" << name << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    
+    if (target->isDirectory() && !recursive) {
+        cout << "rm: невозможно удалить '" << name << "': Это каталог (используйте -r)" << endl;
+        return false;
+    }
+    
+    if (!checkWritePermission(parent)) {
+        cout << "rm: невозможно удалить '" << name << "': Отказано в доступе" << endl;
+        return false;
+    }
+    
+    if (!unlinkChild(parent, target)) {
+        cout << "rm: невозможно удалить '" << name << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    if (target->isDirectory()) {
+        reclaimer.defer(move(target));
+    }
+    return true;
+}
+
+NodePtr FileSystem::cloneTree(const NodePtr& source, FSNode* parent, string_view name, const Snapshot* snap) {
+    NodeView view;
+    if (snap) {
+        view = snapshotView(*snap, source);
+    } else {
+        ReadLock guard(lockOf(source));
+        view.capture(source.get());
+    }
+    
+    NodePtr copy = inodes.create(name, source->type, parent);
+    copy->permissions = view.permissions;
+    if (copy->isFile()) {
+        copy->content() = view.content;
+        return copy;
+    }
+    
+    vector<NodePtr> items;
+    items.reserve(view.children.size());
+    Usage total;
+    for (const auto& child : view.children) {
+        items.push_back(cloneTree(child.node, copy.get(), child.name, snap));
+        total += items.back()->usage();
+    }
+    copy->htree().bulkLoad(move(items));
+    copy->htree().addUsage(total);
+    return copy;
+}
+
+bool FileSystem::cp(const string& source, const string& destination, bool recursive) {
+    shared_ptr<Snapshot> snap;
+    auto src = isSnapshotPath(source) ? snapshotWalk(source, snap) : resolvePath(source);
+    
+    if (!src) {
+        cout << "cp: не удалось выполнить stat для '" << source << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    
+    if (src->isDirectory() && !recursive) {
+        cout << "cp: не указан -r; пропускается каталог '" << source << "'" << endl;
+        return false;
+    }
+    
+    if (snap ? !(snapshotView(*snap, src).permissions.owner & 4) : !checkReadPermission(src)) {
+        cout << "cp: невозможно открыть '" << source << "' для чтения: Отказано в доступе" << endl;
+        return false;
+    }
+    
+    if (isSnapshotPath(destination)) {
+        cout << "cp: невозможно создать '" << destination << "': Файловая система только для чтения" << endl;
+        return false;
+    }
+    
+    PathComponent leaf;
+    NodePtr parent;
+    auto dst = resolvePath(destination);
+    if (dst && dst->isDirectory()) {
+        parent = dst;
+        leaf = {src->name, src->nameHash};
+        dst = step(parent, leaf);
+    } else {
+        parent = resolveParent(destination, leaf);
+    }
+    
+    if (!parent || leaf.name.empty()) {
+        cout << "cp: невозможно создать '" << destination << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    
+    if (dst == src && !snap) {
+        cout << "cp: '" << source << "' и '" << destination << "' — один и тот же файл" << endl;
+        return false;
+    }
+    
+    if (src->isDirectory()) {
+        if (dst) {
+            cout << "cp: невозможно создать каталог '" << destination << "': Файл существует" << endl;
+            return false;
+        }
+        for (NodePtr up = snap ? nullptr : parent; up; up = up->parentHandle()) {
+            if (up == src) {
+                cout << "cp: невозможно скопировать каталог '" << source << "' в самого себя" << endl;
+                return false;
+            }
+        }
+    } else if (dst) {
+        if (!dst->isFile()) {
+            cout << "cp: невозможно перезаписать каталог '" << destination << "' файлом" << endl;
+            return false;
+        }
+        if (!checkWritePermission(dst)) {
+            cout << "cp: невозможно создать обычный файл '" << destination << "': Отказано в доступе" << endl;
+            return false;
+        }
+        Rope content;
+        if (snap) {
+            content = snapshotView(*snap, src).content;
+        } else {
+            ReadLock guard(lockOf(src));
+            content = src->content();
+        }
+        WriteLock guard(lockOf(dst));
+        preserve(dst);
+        int before = dst->content().length();
+        dst->content().swap(content);
+        inodes.bumpVersion(dst->ino);
+        accountResize(dst, before, guard);
+        return true;
+    }
+    
+    if (!checkWritePermission(parent)) {
+        cout << "cp: невозможно создать '" << destination << "': Отказано в доступе" << endl;
+        return false;
+    }
+    
+    if (!linkChild(parent, cloneTree(src, parent.get(), leaf.name, snap.get()))) {
+        cout << "cp: невозможно создать '" << destination << "': Файл существует" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool FileSystem::rename(const string& source, const string& destination) {
+    if (isSnapshotPath(source) || isSnapshotPath(destination)) {
+        cout << "mv: невозможно переместить '" << source << "' в '" << destination
+             << "': Файловая система только для чтения" << endl;
+        return false;
+    }
+    
+    PathComponent srcLeaf, dstLeaf;
+    auto srcParent = resolveParent(source, srcLeaf);
+    auto src = srcParent ? step(srcParent, srcLeaf) : nullptr;
+    if (!src) {
+        cout << "mv: не удалось выполнить stat для '" << source << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    
+    auto dstParent = resolveParent(destination, dstLeaf);
+    if (!dstParent || (dstParent == root && dstLeaf.name == Snapshot::MOUNT)) {
+        cout << "mv: невозможно переместить '" << source << "' в '" << destination
+             << "': Нет такого файла или каталога" << endl;
+        return false;
+    }
+    
+    if (!checkWritePermission(srcParent) || !checkWritePermission(dstParent)) {
+        cout << "mv: невозможно переместить '" << source << "': Отказано в доступе" << endl;
+        return false;
+    }
+    
+    WriteLock treeGuard(renameLock, defer_lock);
+    if (src->isDirectory()) {
+        treeGuard.lock();
+        for (NodePtr up = dstParent; up; up = up->parentHandle()) {
+            if (up == src) {
+                cout << "mv: невозможно переместить '" << source << "' в свой же подкаталог '"
+                     << destination << "'" << endl;
+                return false;
+            }
+        }
+    }
+    
+    string oldPath = pathOf(src.get());
+    NodePtr existing;
+    vector<uint32_t> stripes;
+    while (true) {
+        existing = step(dstParent, dstLeaf);
+        if (existing == src) {
             return true;
         }
         
-        string currentPath = getCurrentPath();
-        size_t lastSlash = currentPath.find_last_of('/');
+        stripes = {InodeTable::stripeOf(srcParent->ino), InodeTable::stripeOf(dstParent->ino),
+                   InodeTable::stripeOf(src->ino)};
+        if (existing) {
+            stripes.push_back(InodeTable::stripeOf(existing->ino));
+        }
+        sort(stripes.begin(), stripes.end());
+        stripes.erase(unique(stripes.begin(), stripes.end()), stripes.end());
+        for (uint32_t stripe : stripes) {
+            inodes.stripeLock(stripe).lock();
+        }
         
-        if (lastSlash == 0) {
-            currentDir = root;
+        if (srcParent->findChild(srcLeaf.name, srcLeaf.hash) != src) {
+            break;
+        }
+        if (dstParent->findChild(dstLeaf.name, dstLeaf.hash) == existing) {
+            break;
+        }
+        for (auto it = stripes.rbegin(); it != stripes.rend(); ++it) {
+            inodes.stripeLock(*it).unlock();
+        }
+    }
+    
+    string error;
+    string_view oldName;
+    Usage moved, replaced;
+    if (srcParent->findChild(srcLeaf.name, srcLeaf.hash) != src) {
+        error = "Нет такого файла или каталога";
+    } else if (existing && existing->isDirectory() && !src->isDirectory()) {
+        error = "Невозможно перезаписать каталог не-каталогом";
+    } else if (existing && !existing->isDirectory() && src->isDirectory()) {
+        error = "Невозможно перезаписать не-каталог каталогом";
+    } else if (existing && existing->isDirectory() && !existing->htree().empty()) {
+        error = "Каталог не пуст";
+    }
+    
+    if (error.empty()) {
+        preserve(srcParent, src->name, src->nameHash, src);
+        preserve(dstParent, dstLeaf.name, dstLeaf.hash, existing);
+        srcParent->removeChild(src->name, src->nameHash);
+        if (src->name != dstLeaf.name) {
+            EpochReclaimer::synchronize();
+            oldName = src->name;
+            src->name = names.intern(dstLeaf.name);
+            src->nameHash = dstLeaf.hash;
+        }
+        src->parent = dstParent.get();
+        moved = src->usage();
+        if (existing) {
+            replaced = detachUsage(existing);
+            dstParent->htree().replace(src);
         } else {
-            string parentPath = currentPath.substr(0, lastSlash);
-            currentDir = findNode(parentPath);
-            
-            if (!currentDir) {
-                currentDir = root;
+            dstParent->addChild(src, true);
+        }
+        inodes.bumpVersion(srcParent->ino);
+        inodes.bumpVersion(dstParent->ino);
+        inodes.bumpVersion(src->ino);
+    }
+    
+    for (auto it = stripes.rbegin(); it != stripes.rend(); ++it) {
+        inodes.stripeLock(*it).unlock();
+    }
+    if (oldName.data()) {
+        names.release(oldName);
+    }
+    
+    if (!error.empty()) {
+        cout << "mv: невозможно переместить '" << source << "' в '" << destination << "': " << error << endl;
+        return false;
+    }
+    if (dstParent != srcParent) {
+        account(srcParent, -moved);
+        account(dstParent, moved);
+    }
+    account(dstParent, -replaced);
+    invalidatePath(oldPath);
+    invalidatePath(src.get());
+    return true;
+}
+
+bool FileSystem::mv(const string& source, const string& destination) {
+    auto target = isSnapshotPath(destination) ? nullptr : resolvePath(destination);
+    if (target && target->isDirectory()) {
+        PathIterator it(source);
+        string_view name;
+        for (; !it.done(); ++it) {
+            name = it->name;
+        }
+        string inside = destination;
+        if (inside.back() != '/') {
+            inside += '/';
+        }
+        return rename(source, inside + string(name));
+    }
+    return rename(source, destination);
+}
+
+DirCursor FileSystem::openDirNode(NodePtr dir, bool sorted, const string& prefix) {
+    DirCursor cursor;
+    cursor.dir = dir;
+    cursor.sorted = sorted;
+    cursor.prefix = prefix;
+    return cursor;
+}
+
+DirCursor FileSystem::openDir(const string& path, bool sorted) {
+    auto dir = resolvePath(path);
+    if (!dir || !dir->isDirectory() || !checkReadPermission(dir)) {
+        return DirCursor();
+    }
+    return openDirNode(dir, sorted);
+}
+
+vector<DirEntry> FileSystem::readDir(DirCursor& cursor, size_t batch) {
+    vector<DirEntry> entries;
+    if (!cursor.valid() || cursor.eof || batch == 0) {
+        return entries;
+    }
+    
+    vector<NodePtr> nodes;
+    if (cursor.sorted) {
+        string from = cursor.started ? cursor.name + '\0' : cursor.prefix;
+        WriteLock guard(lockOf(cursor.dir));
+        nodes = cursor.dir->htree().lowerBound(from, batch);
+    } else {
+        ReadLock guard(lockOf(cursor.dir));
+        if (cursor.started) {
+            nodes = cursor.dir->htree().entriesAfter(cursor.hash, cursor.name, batch);
+        } else {
+            nodes = cursor.dir->htree().entriesAfter(0, "", batch);
+        }
+    }
+    
+    for (const auto& node : nodes) {
+        DirEntry entry;
+        {
+            ReadLock guard(lockOf(node));
+            entry = {string(node->name), node->type, node->permissions, 0};
+            cursor.hash = node->nameHash;
+        }
+        cursor.name = entry.name;
+        if (entry.name.compare(0, cursor.prefix.size(), cursor.prefix) != 0) {
+            cursor.eof = true;
+            break;
+        }
+        entry.size = node->isFile() ? contentLength(node) : node->htree().usage().bytes;
+        entries.push_back(move(entry));
+    }
+    
+    if (nodes.size() < batch) {
+        cursor.eof = true;
+    }
+    if (!nodes.empty()) {
+        cursor.started = true;
+    }
+    
+    return entries;
+}
+
+void FileSystem::printEntries(const vector<DirEntry>& entries, bool showDetails) {
+    for (const auto& entry : entries) {
+        bool isDir = entry.type == NodeType::DIRECTORY;
+        if (!showDetails) {
+            if (isDir) {
+                cout << "\033[1;34m" << entry.name << "/\033[0m  ";
+            } else {
+                cout << entry.name << "  ";
             }
+            continue;
         }
         
-        return true;
-    } else {
-        target = resolvePath(path);
+        cout << (isDir ? "d" : "-");
+        cout << entry.permissions.toString() << "  ";
+        cout << setw(10) << entry.size << "  ";
+        
+        if (isDir) {
+            cout << "\033[1;34m" << entry.name << "/\033[0m" << endl;
+        } else {
+            cout << entry.name << endl;
+        }
+    }
+}
+
+void FileSystem::printListing(DirCursor& cursor, bool showDetails) {
+    const size_t batchSize = 256;
+    bool printed = false;
+    
+    for (auto batch = readDir(cursor, batchSize); !batch.empty(); batch = readDir(cursor, batchSize)) {
+        printed = true;
+        printEntries(batch, showDetails);
+    }
+    
+    if (printed && !showDetails) {
+        cout << endl;
+    }
+}
+
+void FileSystem::ls(bool showDetails) {
+    DirCursor cursor = openDirNode(cwd(), true);
+    printListing(cursor, showDetails);
+}
+
+void FileSystem::ls(const string& path, bool showDetails) {
+    if (path.find('*') != string::npos) {
+        lsGlob(path, showDetails);
+        return;
     }
     
-    if (!target) {
-        cout << "cd: " << path << ": Нет такого файла или каталога" << endl;
-        return false;
+    if (isSnapshotPath(path)) {
+        lsSnapshot(path, showDetails);
+        return;
     }
     
-    if (!target->isDirectory()) {
-        cout << "cd: " << path << ": Это не каталог" << endl;
-        return false;
+    auto dir = resolvePath(path);
+    
+    if (!dir) {
+        cout << "ls: невозможно получить доступ к '" << path << "': Нет такого файла или каталога" << endl;
+        return;
     }
     
-    if (!checkExecutePermission(target)) {
-        cout << "cd: " << path << ": Отказано в доступе" << endl;
-        return false;
+    if (!dir->isDirectory()) {
+        cout << "ls: '" << path << "': Не является каталогом" << endl;
+        return;
     }
     
-    currentDir = target;
-    return true;
+    if (!checkReadPermission(dir)) {
+        cout << "ls: невозможно открыть каталог '" << path << "': Отказано в доступе" << endl;
+        return;
+    }
+    
+    DirCursor cursor = openDirNode(dir, true);
+    printListing(cursor, showDetails);
 }
 
-bool FileSystem::mkdir(const string& name) {
-    if (name.empty()) {
-        cout << "mkdir: отсутствует операнд" << endl;
-        return false;
-    }
+void FileSystem::lsGlob(const string& pattern, bool showDetails) {
+    size_t lastSlash = pattern.find_last_of('/');
+    string dirPath = pattern.substr(0, lastSlash == string::npos ? 0 : lastSlash + 1);
+    string prefix = pattern.substr(lastSlash == string::npos ? 0 : lastSlash + 1);
     
-    if (name.find('/') != string::npos) {
-        bool result = createDirectory(name, !debugMode);
-        if (!result) {
-            cout << "mkdir: невозможно создать каталог '" << name << "': Отказано в доступе" << endl;
-        }
-        return result;
+    if (prefix.find('*') != prefix.size() - 1 || dirPath.find('*') != string::npos) {
+        cout << "ls: '" << pattern << "': поддерживается только шаблон вида префикс*" << endl;
+        return;
     }
+    prefix.pop_back();
     
-    if (!checkWritePermission(currentDir)) {
-        cout << "mkdir: невозможно создать каталог '" << name << "': Отказано в доступе" << endl;
-        return false;
+    auto dir = dirPath.empty() ? cwd() : resolvePath(dirPath);
+    if (!dir || !dir->isDirectory()) {
+        cout << "ls: невозможно получить доступ к '" << pattern << "': Нет такого файла или каталога" << endl;
+        return;
     }
     
-    if (currentDir->findChild(name)) {
-        cout << "mkdir: невозможно создать каталог '" << name << "': Файл существует" << endl;
-        return false;
+    if (!checkReadPermission(dir)) {
+        cout << "ls: невозможно открыть каталог '" << dirPath << "': Отказано в доступе" << endl;
+        return;
     }
     
-    auto newDir = make_shared<FSNode>(name, NodeType::DIRECTORY, currentDir.get());
-    currentDir->addChild(newDir, !debugMode);
-    return true;
+    DirCursor cursor = openDirNode(dir, true, prefix);
+    printListing(cursor, showDetails);
 }
 
-bool FileSystem::touch(const string& name) {
-    if (name.empty()) {
-        cout << "touch: отсутствует операнд" << endl;
-        return false;
+size_t FileSystem::freezeRecursive(NodePtr node) {
+    if (!node || !node->isDirectory()) return 0;
+    
+    size_t frozenCount = 0;
+    auto children = childrenOf(node);
+    for (auto& child : children) {
+        frozenCount += freezeRecursive(child);
     }
     
-    if (name.find('/') != string::npos) {
-        bool result = createFile(name, "", !debugMode);
-        if (!result) {
-            cout << "touch: невозможно создать '" << name << "': Отказано в доступе" << endl;
-        }
-        return result;
+    WriteLock guard(lockOf(node));
+    if (!node->htree().isInline() && !node->htree().isFrozen()) {
+        node->htree().freeze();
+        frozenCount++;
     }
+    return frozenCount;
+}
+
+bool FileSystem::freeze(const string& path) {
+    auto dir = resolvePath(path);
     
-    if (currentDir->findChild(name)) {
-        return true;
+    if (!dir) {
+        cout << "freeze: '" << path << "': Нет такого файла или каталога" << endl;
+        return false;
     }
     
-    if (!checkWritePermission(currentDir)) {
-        cout << "touch: невозможно создать файл '" << name << "': Отказано в доступе" << endl;
+    if (!dir->isDirectory()) {
+        cout << "freeze: '" << path << "': Не является каталогом" << endl;
         return false;
     }
     
-    auto newFile = make_shared<FSNode>(name, NodeType::FILE, currentDir.get());
-    currentDir->addChild(newFile, !debugMode);
+    size_t frozenCount = freezeRecursive(dir);
+    if (debugMode) {
+        cout << "freeze: уплотнено каталогов: " << frozenCount << endl;
+    }
     return true;
 }
 
-void FileSystem::cat(const string& name) {
-    auto file = resolvePath(name);
-    
-    if (!file) {
-        cout << "cat: " << name << ": Нет такого файла или каталога" << endl;
-        return;
+bool FileSystem::isSnapshotPath(string_view path) {
+    PathIterator it(path);
+    return !path.empty() && path[0] == '/' && !it.done() && it->name == Snapshot::MOUNT;
+}
+
+shared_ptr<Snapshot> FileSystem::findSnapshot(string_view name) const {
+    ReadLock guard(snapshotLock);
+    for (const auto& snap : snapshots) {
+        if (snap->name() == name) {
+            return snap;
+        }
     }
-    
-    if (!file->isFile()) {
-        cout << "cat: " << name << ": Это каталог" << endl;
-        return;
+    return nullptr;
+}
+
+NodePtr FileSystem::snapshotStep(const Snapshot& snap, const NodePtr& dir, const PathComponent& comp) const {
+    ReadLock guard(lockOf(dir));
+    ReadLock snapGuard(snapshotLock);
+    if (const PreservedNode* kept = snap.find(dir->ino)) {
+        if (const PreservedEntry* change = kept->findChange(comp.name, comp.hash)) {
+            return change->node;
+        }
     }
-    
-    if (!checkReadPermission(file)) {
-        cout << "cat: " << name << ": Отказано в доступе" << endl;
-        return;
+    return dir->findChild(comp.name, comp.hash);
+}
+
+NodePtr FileSystem::snapshotWalk(string_view path, shared_ptr<Snapshot>& snap) {
+    PathIterator it(path);
+    ++it;
+    if (it.done() || !(snap = findSnapshot(it->name))) {
+        return nullptr;
     }
     
-    cout << file->content.toString();
+    vector<NodePtr> trail{root};
+    for (++it; !it.done(); ++it) {
+        if (!trail.back()->isDirectory()) {
+            return nullptr;
+        }
+        if (it->name == "..") {
+            if (trail.size() > 1) {
+                trail.pop_back();
+            }
+            continue;
+        }
+        NodePtr child = snapshotStep(*snap, trail.back(), *it);
+        if (!child) {
+            return nullptr;
+        }
+        trail.push_back(move(child));
+    }
+    return trail.back();
 }
 
-bool FileSystem::writeFile(const string& name, const string& content) {
-    auto file = resolvePath(name);
+NodeView FileSystem::snapshotView(const Snapshot& snap, const NodePtr& node) const {
+    ReadLock guard(lockOf(node));
+    ReadLock snapGuard(snapshotLock);
+    NodeView view;
+    view.capture(node.get(), snap.find(node->ino));
+    return view;
+}
+
+DirEntry FileSystem::snapshotEntry(const Snapshot& snap, const PreservedEntry& entry) const {
+    const NodePtr& node = entry.node;
+    ReadLock guard(lockOf(node));
+    ReadLock snapGuard(snapshotLock);
+    const PreservedNode* kept = snap.find(node->ino);
+    int64_t size = 0;
+    if (node->isFile()) {
+        size = kept ? kept->content.length() : node->content().length();
+    }
+    return {string(entry.name), node->type, kept ? kept->permissions : node->permissions, size};
+}
+
+void FileSystem::lsSnapshot(const string& path, bool showDetails) {
+    vector<DirEntry> entries;
+    PathIterator it(path);
     
-    if (!file) {
-        shared_ptr<FSNode> parent;
-        string fileName;
+    if ((++it).done()) {
+        for (const auto& name : listSnapshots()) {
+            entries.push_back({name, NodeType::DIRECTORY, Permissions(), 0});
+        }
+    } else {
+        shared_ptr<Snapshot> snap;
+        auto dir = snapshotWalk(path, snap);
         
-        size_t lastSlash = name.find_last_of('/');
-        if (lastSlash != string::npos) {
-            string parentPath = name.substr(0, lastSlash);
-            fileName = name.substr(lastSlash + 1);
-            
-            if (parentPath.empty()) {
-                parent = root;
-            } else {
-                parent = resolvePath(parentPath);
-            }
-        } else {
-            parent = currentDir;
-            fileName = name;
+        if (!dir) {
+            cout << "ls: невозможно получить доступ к '" << path << "': Нет такого файла или каталога" << endl;
+            return;
         }
         
-        if (!parent || !parent->isDirectory()) {
-            cout << "Ошибка: Путь не существует" << endl;
-            return false;
+        if (!dir->isDirectory()) {
+            cout << "ls: '" << path << "': Не является каталогом" << endl;
+            return;
         }
         
-        auto newFile = make_shared<FSNode>(fileName, NodeType::FILE, parent.get());
-        newFile->content = Rope(content);
-        parent->addChild(newFile, !debugMode);
-        return true;
-    }
-    
-    if (!file->isFile()) {
-        cout << "Ошибка: " << name << " является каталогом" << endl;
-        return false;
+        NodeView view = snapshotView(*snap, dir);
+        if (!(view.permissions.owner & 4)) {
+            cout << "ls: невозможно открыть каталог '" << path << "': Отказано в доступе" << endl;
+            return;
+        }
+        
+        for (const auto& child : view.children) {
+            entries.push_back(snapshotEntry(*snap, child));
+        }
+        sort(entries.begin(), entries.end(),
+             [](const DirEntry& a, const DirEntry& b) { return a.name < b.name; });
     }
     
-    if (!checkWritePermission(file)) {
-        cout << "Ошибка: " << name << ": Отказано в доступе" << endl;
-        return false;
+    printEntries(entries, showDetails);
+    if (!entries.empty() && !showDetails) {
+        cout << endl;
     }
-    
-    file->content = Rope(content);
-    return true;
 }
 
-bool FileSystem::appendFile(const string& name, const string& content) {
-    auto file = resolvePath(name);
-    
-    if (!file) {
-        return writeFile(name, content);
+bool FileSystem::snapshot(const string& name) {
+    if (name.empty() || name == "." || name == ".." || name.find('/') != string::npos) {
+        cout << "snapshot: недопустимое имя снимка '" << name << "'" << endl;
+        return false;
     }
     
-    if (!file->isFile()) {
-        cout << "Ошибка: " << name << " является каталогом" << endl;
-        return false;
+    inodes.lockAllStripes();
+    WriteLock guard(snapshotLock);
+    bool exists = false;
+    for (const auto& snap : snapshots) {
+        exists = exists || snap->name() == name;
     }
+    if (!exists) {
+        snapshots.push_back(make_shared<Snapshot>(name, inodes.advanceEpoch()));
+    }
+    guard.unlock();
+    inodes.unlockAllStripes();
     
-    if (!checkWritePermission(file)) {
-        cout << "Ошибка: " << name << ": Отказано в доступе" << endl;
+    if (exists) {
+        cout << "snapshot: снимок '" << name << "' уже существует" << endl;
         return false;
     }
-    
-    file->content.append(content);
+    if (debugMode) {
+        cout << "snapshot: создан снимок /" << Snapshot::MOUNT << "/" << name << endl;
+    }
     return true;
 }
 
-bool FileSystem::rm(const string& name, bool recursive) {
-    auto target = resolvePath(name);
-    
-    if (!target) {
-        cout << "rm: невозможно удалить '" << name << "': Нет такого файла или каталога" << endl;
-        return false;
+bool FileSystem::deleteSnapshot(const string& name) {
+    shared_ptr<Snapshot> removed;
+    
+    inodes.lockAllStripes();
+    WriteLock guard(snapshotLock);
+    for (auto it = snapshots.begin(); it != snapshots.end(); ++it) {
+        if ((*it)->name() == name) {
+            removed = move(*it);
+            snapshots.erase(it);
+            break;
+        }
     }
+    guard.unlock();
+    inodes.unlockAllStripes();
     
-    if (target->isDirectory() && !recursive) {
-        cout << "rm: невозможно удалить '" << name << "': Это каталог (используйте -r)" << endl;
+    if (!removed) {
+        cout << "snapshot: снимок '" << name << "' не найден" << endl;
         return false;
     }
-    
-    shared_ptr<FSNode> parent;
-    string fileName;
-    
-    size_t lastSlash = name.find_last_of('/');
-    if (lastSlash != string::npos) {
-        string parentPath = name.substr(0, lastSlash);
-        fileName = name.substr(lastSlash + 1);
-        
-        if (parentPath.empty()) {
-            parent = root;
-        } else {
-            parent = resolvePath(parentPath);
-        }
-    } else {
-        parent = currentDir;
-        fileName = name;
+    if (debugMode) {
+        cout << "snapshot: удалён снимок '" << name << "', сохранённых узлов: "
+             << removed->preservedCount() << endl;
     }
-    
-    if (parent) {
-        if (!checkWritePermission(parent)) {
-            cout << "rm: невозможно удалить '" << name << "': Отказано в доступе" << endl;
-            return false;
+    if (removed.use_count() == 1) {
+        vector<NodePtr> retained;
+        removed->takeNodes(retained);
+        for (auto& node : retained) {
+            reclaimer.defer(move(node));
         }
-        parent->removeChild(fileName);
     }
     return true;
 }
 
-void FileSystem::ls(bool showDetails) {
-    auto children = currentDir->getChildren();
-    
-    if (children.empty()) {
-        return;
-    }
-    
-    if (!showDetails) {
-        for (const auto& child : children) {
-            if (child->isDirectory()) {
-                cout << "\033[1;34m" << child->name << "/\033[0m  ";
-            } else {
-                cout << child->name << "  ";
-            }
-        }
-        cout << endl;
-    } else {
-        for (const auto& child : children) {
-            cout << (child->isDirectory() ? "d" : "-");
-            cout << child->permissions.toString() << "  ";
-            cout << setw(10) << (child->isFile() ? child->content.length() : 0) << "  ";
-            
-            if (child->isDirectory()) {
-                cout << "\033[1;34m" << child->name << "/\033[0m" << endl;
-            } else {
-                cout << child->name << endl;
-            }
+vector<string> FileSystem::listSnapshots() const {
+    vector<string> result;
+    ReadLock guard(snapshotLock);
+    for (const auto& snap : snapshots) {
+        result.push_back(snap->name());
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+size_t FileSystem::snapshotPreservedNodes(const string& name) const {
+    auto snap = findSnapshot(name);
+    if (!snap) return 0;
+    ReadLock guard(snapshotLock);
+    return snap->preservedCount();
+}
+
+size_t FileSystem::nodeCount() const {
+    return inodes.size();
+}
+
+size_t FileSystem::pendingReclaim() const {
+    return reclaimer.pending();
+}
+
+void FileSystem::waitForReclaim() {
+    reclaimer.drain();
+}
+
+void FileSystem::duRecursive(const NodePtr& dir, const string& path) {
+    vector<pair<string, NodePtr>> subdirs;
+    for (auto& child : childrenOf(dir)) {
+        if (child->isDirectory()) {
+            subdirs.emplace_back(nameOf(child), move(child));
         }
     }
+    sort(subdirs.begin(), subdirs.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+    for (const auto& [name, child] : subdirs) {
+        string childPath = path.back() == '/' ? path + name : path + "/" + name;
+        duRecursive(child, childPath);
+        cout << child->htree().usage().bytes << "\t" << childPath << endl;
+    }
 }
 
-void FileSystem::ls(const string& path, bool showDetails) {
-    auto dir = resolvePath(path);
-    
-    if (!dir) {
-        cout << "ls: невозможно получить доступ к '" << path << "': Нет такого файла или каталога" << endl;
-        return;
-    }
+bool FileSystem::du(const string& path, bool summarize) {
+    auto target = resolvePath(path);
     
-    if (!dir->isDirectory()) {
-        cout << "ls: '" << path << "': Не является каталогом" << endl;
-        return;
+    if (!target) {
+        cout << "du: невозможно получить доступ к '" << path << "': Нет такого файла или каталога" << endl;
+        return false;
     }
     
-    if (!checkReadPermission(dir)) {
-        cout << "ls: невозможно открыть каталог '" << path << "': Отказано в доступе" << endl;
-        return;
+    if (!checkReadPermission(target)) {
+        cout << "du: невозможно прочитать '" << path << "': Отказано в доступе" << endl;
+        return false;
     }
     
-    auto children = dir->getChildren();
-    
-    if (children.empty()) {
-        return;
+    Usage total;
+    {
+        ReadLock guard(lockOf(target));
+        total = target->usage();
     }
-    
-    if (!showDetails) {
-        for (const auto& child : children) {
-            if (child->isDirectory()) {
-                cout << "\033[1;34m" << child->name << "/\033[0m  ";
-            } else {
-                cout << child->name << "  ";
-            }
-        }
-        cout << endl;
-    } else {
-        for (const auto& child : children) {
-            cout << (child->isDirectory() ? "d" : "-");
-            cout << child->permissions.toString() << "  ";
-            cout << setw(10) << (child->isFile() ? child->content.length() : 0) << "  ";
-            
-            if (child->isDirectory()) {
-                cout << "\033[1;34m" << child->name << "/\033[0m" << endl;
-            } else {
-                cout << child->name << endl;
-            }
-        }
+    if (!summarize && target->isDirectory()) {
+        duRecursive(target, path);
     }
+    cout << total.bytes << "\t" << path << "  (файлов: " << total.files
+         << ", каталогов: " << total.dirs << ")" << endl;
+    return true;
+}
+
+Usage FileSystem::usage(const string& path) {
+    auto target = resolvePath(path);
+    if (!target) return {};
+    ReadLock guard(lockOf(target));
+    return target->usage();
 }
 
 bool FileSystem::chmod(const string& mode, const string& name) {
@@ -553,27 +1452,28 @@ bool FileSystem::chmod(const string& mode, const string& name) {
         return false;
     }
     
-    if (mode.length() != 3) {
+    if (mode.length() != 3 || any_of(mode.begin(), mode.end(), [](char c) { return c < '0' || c > '7'; })) {
         cout << "chmod: неверный формат прав (используйте, например, 755)" << endl;
         return false;
     }
     
-    target->permissions.owner = mode[0] - '0';
-    target->permissions.group = mode[1] - '0';
-    target->permissions.others = mode[2] - '0';
+    {
+        WriteLock guard(lockOf(target));
+        preserve(target);
+        target->permissions.owner = mode[0] - '0';
+        target->permissions.group = mode[1] - '0';
+        target->permissions.others = mode[2] - '0';
+        inodes.bumpVersion(target->ino);
+    }
+    invalidatePath(target.get());
     
     return true;
 }
 
 void FileSystem::findFiles(const string& name) {
-    vector<string> results;
-    
-    auto children = currentDir->getChildren();
-    string basePath = getCurrentPath();
-    
-    for (auto& child : children) {
-        searchRecursive(child, name, basePath, results);
-    }
+    NodePtr dir = cwd();
+    string basePath = pathOf(dir.get());
+    auto results = searchTree(dir, basePath == "/" ? "" : basePath, name);
     
     if (results.empty()) {
         return;
@@ -589,25 +1489,28 @@ bool FileSystem::createDirectory(const string& path, bool silent) {
         cout << "\n[Создание директории] " << path << endl;
     }
 
-    vector<string> components = splitPath(path);
-    if (components.empty()) {
+    PathIterator it(path);
+    if (it.done()) {
         if (!silent) {
             cout << "  [Ошибка] Неверный путь" << endl;
         }
         return false;
     }
 
-    shared_ptr<FSNode> current = root;
+    NodePtr current = root;
     string currentPath = "";
 
-    for (size_t i = 0; i < components.size(); i++) {
-        const string& comp = components[i];
-        currentPath += "/" + comp;
+    for (; !it.done(); ++it) {
+        bool last = it.isLast();
+        if (!silent) {
+            currentPath += "/";
+            currentPath += it->name;
+        }
 
-        auto child = current->findChild(comp);
+        auto child = step(current, *it);
 
         if (!child) {
-            if (i < components.size() - 1) {
+            if (!last) {
                 if (!silent) {
                     cout << "  [Ошибка] Директория '" << currentPath << "' не существует" << endl;
                 }
@@ -621,8 +1524,12 @@ bool FileSystem::createDirectory(const string& path, bool silent) {
                 return false;
             }
 
-            auto newDir = make_shared<FSNode>(comp, NodeType::DIRECTORY, current.get());
-            current->addChild(newDir, silent);
+            if (!createChild(current, *it, NodeType::DIRECTORY, "", silent)) {
+                if (!silent) {
+                    cout << "  [Ошибка] Директория уже существует" << endl;
+                }
+                return false;
+            }
             if (!silent) {
                 cout << "  [Успех] Создана директория: " << currentPath << endl;
             }
@@ -635,7 +1542,7 @@ bool FileSystem::createDirectory(const string& path, bool silent) {
                 return false;
             }
 
-            if (i == components.size() - 1) {
+            if (last) {
                 if (!silent) {
                     cout << "  [Ошибка] Директория уже существует" << endl;
                 }
@@ -654,29 +1561,23 @@ bool FileSystem::createFile(const string& path, const string& content, bool sile
         cout << "\n[Создание файла] " << path << endl;
     }
     
-    vector<string> components = splitPath(path);
-    if (components.empty()) {
+    if (PathIterator(path).done()) {
         if (!silent) {
             cout << "  [Ошибка] Неверный путь" << endl;
         }
         return false;
     }
     
-    string fileName = components.back();
-    components.pop_back();
-    
-    shared_ptr<FSNode> parent = root;
-    for (const auto& comp : components) {
-        parent = parent->findChild(comp);
-        if (!parent || !parent->isDirectory()) {
-            if (!silent) {
-                cout << "  [Ошибка] Путь не существует" << endl;
-            }
-            return false;
+    PathComponent file;
+    NodePtr parent = walk(root, path, &file);
+    if (!parent) {
+        if (!silent) {
+            cout << "  [Ошибка] Путь не существует" << endl;
         }
+        return false;
     }
     
-    if (parent->findChild(fileName)) {
+    if (step(parent, file)) {
         if (!silent) {
             cout << "  [Ошибка] Файл уже существует" << endl;
         }
@@ -690,11 +1591,12 @@ bool FileSystem::createFile(const string& path, const string& content, bool sile
         return false;
     }
     
-    auto newFile = make_shared<FSNode>(fileName, NodeType::FILE, parent.get());
-    if (!content.empty()) {
-        newFile->content = Rope(content);
+    if (!createChild(parent, file, NodeType::FILE, content, silent)) {
+        if (!silent) {
+            cout << "  [Ошибка] Файл уже существует" << endl;
+        }
+        return false;
     }
-    parent->addChild(newFile, silent);
     
     if (!silent) {
         cout << "  [Успех] Создан файл: " << path << endl;
@@ -719,18 +1621,37 @@ bool FileSystem::writeToFile(const string& path, const string& content) {
         return false;
     }
     
-    node->content.append(content);
+    int length;
+    {
+        WriteLock guard(lockOf(node));
+        preserve(node);
+        int before = node->content().length();
+        node->content().append(content);
+        length = node->content().length();
+        inodes.bumpVersion(node->ino);
+        accountResize(node, before, guard);
+    }
     cout << "  [Успех] Записано " << content.length() << " символов" << endl;
-    cout << "  [Rope] Текущая длина: " << node->content.length() << " символов" << endl;
+    cout << "  [Rope] Текущая длина: " << length << " символов" << endl;
     return true;
 }
 
 string FileSystem::readFile(const string& path) {
+    if (isSnapshotPath(path)) {
+        shared_ptr<Snapshot> snap;
+        auto node = snapshotWalk(path, snap);
+        if (!node || !node->isFile()) {
+            return "";
+        }
+        return snapshotView(*snap, node).content.toString();
+    }
+
     auto node = findNode(path);
     if (!node || !node->isFile()) {
         return "";
     }
-    return node->content.toString();
+    ReadLock guard(lockOf(node));
+    return node->content().toString();
 }
 
 int FileSystem::findInFile(const string& path, const string& substr) {
@@ -739,7 +1660,8 @@ int FileSystem::findInFile(const string& path, const string& substr) {
         return -1;
     }
     
-    return node->content.find(substr);
+    ReadLock guard(lockOf(node));
+    return node->content().find(substr);
 }
 
 bool FileSystem::deleteFromFile(const string& path, const string& substr) {
@@ -752,7 +1674,13 @@ bool FileSystem::deleteFromFile(const string& path, const string& substr) {
         return false;
     }
     
-    return node->content.deleteSubstring(substr);
+    WriteLock guard(lockOf(node));
+    preserve(node);
+    inodes.bumpVersion(node->ino);
+    int before = node->content().length();
+    bool deleted = node->content().deleteSubstring(substr);
+    accountResize(node, before, guard);
+    return deleted;
 }
 
 bool FileSystem::insertInFile(const string& path, int pos, const string& text) {
@@ -765,7 +1693,12 @@ bool FileSystem::insertInFile(const string& path, int pos, const string& text) {
         return false;
     }
     
-    node->content.insert(pos, text);
+    WriteLock guard(lockOf(node));
+    preserve(node);
+    int before = node->content().length();
+    node->content().insert(pos, text);
+    inodes.bumpVersion(node->ino);
+    accountResize(node, before, guard);
     return true;
 }
 
@@ -783,7 +1716,7 @@ void FileSystem::listDirectory(const string& path) {
         return;
     }
     
-    auto children = node->getChildren();
+    auto children = childrenOf(node);
     if (children.empty()) {
         cout << "  [Пусто]" << endl;
         return;
@@ -795,27 +1728,33 @@ void FileSystem::listDirectory(const string& path) {
     for (const auto& child : children) {
         cout << "  " << child->permissions.toString() << "  ";
         cout << (child->isDirectory() ? "DIR " : "FILE") << "  ";
-        cout << setw(10) << HashFunction::hash(child->name) << "  ";
+        cout << setw(10) << child->nameHash << "  ";
         
         if (child->isDirectory()) {
-            cout << "\033[1;34m" << child->name << "/\033[0m" << endl;
+            cout << "\033[1;34m" << nameOf(child) << "/\033[0m" << endl;
         } else {
-            cout << child->name;
-            if (!child->content.empty()) {
-                cout << " (" << child->content.length() << " bytes)";
+            cout << nameOf(child);
+            int length = contentLength(child);
+            if (length > 0) {
+                cout << " (" << length << " bytes)";
             }
             cout << endl;
         }
     }
     
-    node->htree.printStats();
+    ReadLock guard(lockOf(node));
+    node->htree().printStats();
 }
 
 vector<string> FileSystem::search(const string& name) {
     cout << "\n[Глобальный поиск] '" << name << "'" << endl;
     
     vector<string> results;
-    searchRecursive(root, name, "", results);
+    if (root->name.find(name) != string::npos) {
+        results.push_back("/");
+    }
+    auto found = searchTree(root, "", name);
+    results.insert(results.end(), make_move_iterator(found.begin()), make_move_iterator(found.end()));
     
     if (results.empty()) {
         cout << "  [Не найдено]" << endl;
@@ -838,14 +1777,17 @@ bool FileSystem::remove(const string& path) {
         return false;
     }
     
-    if (!node->parent) {
+    NodePtr parent = node->parentHandle();
+    if (!parent) {
         cout << "  [Ошибка] Нельзя удалить корневую директорию" << endl;
         return false;
     }
     
-    FSNode* parent = node->parent;
-    if (parent->removeChild(node->name)) {
+    if (unlinkChild(parent, node)) {
         cout << "  [Успех] Удалено из H-Tree" << endl;
+        if (node->isDirectory()) {
+            reclaimer.defer(move(node));
+        }
         return true;
     }
     
@@ -861,11 +1803,26 @@ bool FileSystem::setPermissions(const string& path, int owner, int group, int ot
         return false;
     }
     
-    node->permissions.owner = owner;
-    node->permissions.group = group;
-    node->permissions.others = others;
+    for (int bits : {owner, group, others}) {
+        if (bits < 0 || bits > 7) {
+            cout << "  [Ошибка] Неверные права: " << bits << endl;
+            return false;
+        }
+    }
+    
+    string mode;
+    {
+        WriteLock guard(lockOf(node));
+        preserve(node);
+        node->permissions.owner = owner;
+        node->permissions.group = group;
+        node->permissions.others = others;
+        mode = node->permissions.toString();
+        inodes.bumpVersion(node->ino);
+    }
+    invalidatePath(node.get());
     
-    cout << "  [Успех] Права установлены: " << node->permissions.toString() << endl;
+    cout << "  [Успех] Права установлены: " << mode << endl;
     return true;
 }
 
@@ -875,7 +1832,7 @@ void FileSystem::visualize() {
     cout << string(70, '=') << endl;
     cout << "/" << endl;
     
-    auto children = root->getChildren();
+    auto children = childrenOf(root);
     for (size_t i = 0; i < children.size(); i++) {
         bool isLast = (i == children.size() - 1);
         visualizeTree(children[i], "", isLast);
@@ -897,7 +1854,11 @@ void FileSystem::catFile(const string& path) {
         return;
     }
     
-    string content = node->content.toString();
+    string content;
+    {
+        ReadLock guard(lockOf(node));
+        content = node->content().toString();
+    }
     cout << "  [Содержимое]:" << endl;
     cout << "  " << string(50, '-') << endl;
     
@@ -912,5 +1873,5 @@ void FileSystem::catFile(const string& path) {
     }
     
     cout << "  " << string(50, '-') << endl;
-    cout << "  [Размер] " << node->content.length() << " символов" << endl;
+    cout << "  [Размер] " << content.length() << " символов" << endl;
 }
\ No newline at end of file
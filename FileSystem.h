@@ -1,35 +1,142 @@
 #pragma once
 
 #include "AVLHTree.h"
+#include "DentryCache.h"
+#include "Snapshot.h"
+#include "Reclaimer.h"
+#include "TreeWalker.h"
+#include "Transaction.h"
 #include "Rope.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 using namespace std;
 
 class FSNode;
 
+struct PathComponent {
+    string_view name;
+    uint32_t hash;
+};
+
+class PathIterator {
+    string_view path;
+    size_t next;
+    PathComponent current;
+    bool valid;
+
+    void advance();
+
+public:
+    explicit PathIterator(string_view path);
+    bool done() const;
+    bool isLast() const;
+    const PathComponent& operator*() const;
+    const PathComponent* operator->() const;
+    PathIterator& operator++();
+};
+
+struct DirEntry {
+    string name;
+    NodeType type;
+    Permissions permissions;
+    int64_t size;
+};
+
+struct DirCursor {
+    NodePtr dir;
+    bool sorted = false;
+    bool started = false;
+    bool eof = false;
+    uint32_t hash = 0;
+    string name;
+    string prefix;
+
+    bool valid() const { return dir != nullptr; }
+};
+
 class FileSystem {
-    shared_ptr<FSNode> root;
-    shared_ptr<FSNode> currentDir;
+    friend class Transaction;
+
+    static constexpr int CREATE_ATTEMPTS = 4;
+
+    NameArena names;
+    InodeTable inodes;
+    NodePtr root;
+    NodePtr currentDir;
+    DentryCache dentries;
+    uint64_t cacheEpoch;
+    mutable NodeMutex cwdLock;
+    mutable NodeMutex cacheLock;
+    vector<shared_ptr<Snapshot>> snapshots;
+    mutable NodeMutex snapshotLock;
+    NodeMutex renameLock;
     bool debugMode;
+    size_t walkThreads;
+    Reclaimer reclaimer;
+
+    NodeMutex& lockOf(const NodePtr& node) const;
+    NodePtr cwd() const;
+    bool isMountEntry(const NodePtr& parent, string_view name) const;
+    void setCwd(NodePtr dir);
+    NodePtr createChild(const NodePtr& parent, const PathComponent& comp, NodeType type,
+                        const string& content = "", bool silent = false);
+    bool linkChild(const NodePtr& parent, const NodePtr& child);
+    bool unlinkChild(const NodePtr& parent, const NodePtr& child);
+    vector<NodePtr> childrenOf(const NodePtr& dir) const;
+    string nameOf(const NodePtr& node) const;
+    int contentLength(const NodePtr& file) const;
+    void preserve(const NodePtr& node);
+    void preserve(const NodePtr& dir, string_view name, uint32_t hash, const NodePtr& previous);
+    NodePtr usageParent(const NodePtr& node) const;
+    void account(NodePtr dir, const Usage& delta);
+    void accountResize(const NodePtr& file, int before, WriteLock& guard);
+    Usage detachUsage(const NodePtr& node);
 
-    vector<string> splitPath(const string& path) const;
-    shared_ptr<FSNode> findNode(const string& path);
-    shared_ptr<FSNode> resolvePath(const string& path);
-    string getPathToNode(shared_ptr<FSNode> node);
-    bool checkReadPermission(shared_ptr<FSNode> node);
-    bool checkWritePermission(shared_ptr<FSNode> node);
-    bool checkExecutePermission(shared_ptr<FSNode> node);
-    void searchRecursive(shared_ptr<FSNode> node, const string& name, 
-                        const string& currentPath, vector<string>& results);
-    void visualizeTree(shared_ptr<FSNode> node, const string& prefix, bool isLast);
+    NodePtr step(const NodePtr& current, const PathComponent& comp);
+    NodePtr walk(NodePtr current, string_view path, PathComponent* leaf);
+    NodePtr walkCached(string_view path, PathComponent* leaf);
+    string pathOf(const FSNode* node) const;
+    void invalidatePath(const FSNode* node);
+    void invalidatePath(string_view path);
+    NodePtr findNode(string_view path);
+    NodePtr resolvePath(string_view path);
+    NodePtr resolveParent(string_view path, PathComponent& leaf);
+    bool checkReadPermission(const NodePtr& node);
+    bool checkWritePermission(const NodePtr& node);
+    bool checkExecutePermission(const NodePtr& node);
+    vector<string> searchTree(const NodePtr& start, const string& prefix, const string& name) const;
+    void visualizeTree(const NodePtr& node, const string& prefix, bool isLast);
+    void duRecursive(const NodePtr& dir, const string& path);
+    DirCursor openDirNode(NodePtr dir, bool sorted, const string& prefix = "");
+    void printEntries(const vector<DirEntry>& entries, bool showDetails);
+    void printListing(DirCursor& cursor, bool showDetails);
+    void lsGlob(const string& pattern, bool showDetails);
+    size_t freezeRecursive(NodePtr node);
+    static bool isSnapshotPath(string_view path);
+    shared_ptr<Snapshot> findSnapshot(string_view name) const;
+    NodePtr snapshotStep(const Snapshot& snap, const NodePtr& dir, const PathComponent& comp) const;
+    NodePtr snapshotWalk(string_view path, shared_ptr<Snapshot>& snap);
+    NodeView snapshotView(const Snapshot& snap, const NodePtr& node) const;
+    DirEntry snapshotEntry(const Snapshot& snap, const PreservedEntry& entry) const;
+    void lsSnapshot(const string& path, bool showDetails);
+    NodePtr cloneTree(const NodePtr& source, FSNode* parent, string_view name, const Snapshot* snap);
 
 public:
     FileSystem();
+    ~FileSystem();
+    FileSystem(const FileSystem&) = delete;
+    FileSystem& operator=(const FileSystem&) = delete;
     void toggleDebug();
     bool isDebugMode() const;
+    void setWalkThreads(size_t threads);
+    Transaction beginTransaction();
+    void setPathCacheEnabled(bool enabled);
+    DentryCacheStats pathCacheStats() const;
+    void printPathCacheStats() const;
     string getCurrentPath() const;
     bool changeDirectory(const string& path);
     bool mkdir(const string& name);
@@ -38,9 +145,24 @@ public:
     bool writeFile(const string& name, const string& content);
     bool appendFile(const string& name, const string& content);
     bool rm(const string& name, bool recursive = false);
+    bool cp(const string& source, const string& destination, bool recursive = false);
+    bool rename(const string& source, const string& destination);
+    bool mv(const string& source, const string& destination);
     void ls(bool showDetails = false);
     void ls(const string& path, bool showDetails = false);
     bool chmod(const string& mode, const string& name);
+    bool du(const string& path, bool summarize = false);
+    Usage usage(const string& path);
+    DirCursor openDir(const string& path, bool sorted = false);
+    vector<DirEntry> readDir(DirCursor& cursor, size_t batch);
+    bool freeze(const string& path);
+    bool snapshot(const string& name);
+    bool deleteSnapshot(const string& name);
+    vector<string> listSnapshots() const;
+    size_t snapshotPreservedNodes(const string& name) const;
+    size_t nodeCount() const;
+    size_t pendingReclaim() const;
+    void waitForReclaim();
     void findFiles(const string& name);
     bool createDirectory(const string& path, bool silent = false);
     bool createFile(const string& path, const string& content = "", bool silent = false);
@@ -0,0 +1,80 @@
+#include "FrozenIndex.h"
+#include "AVLHTree.h"
+#include "InodeTable.h"
+#include <algorithm>
+
+using namespace std;
+
+FrozenIndex::FrozenIndex(const vector<InlineEntry>& sorted, const InodeTable* table)
+    : table(table), hashes(sorted.size() + 1), inos(sorted.size() + 1),
+      rank(sorted.size() + 1), order(sorted.size()) {
+    fill(sorted, 0, 1);
+}
+
+string_view FrozenIndex::nameOf(uint32_t ino) const {
+    return table->at(ino)->name;
+}
+
+size_t FrozenIndex::fill(const vector<InlineEntry>& sorted, size_t sortedPos, size_t k) {
+    if (k > sorted.size()) return sortedPos;
+    sortedPos = fill(sorted, sortedPos, 2 * k);
+    hashes[k] = sorted[sortedPos].hash;
+    inos[k] = sorted[sortedPos].ino;
+    rank[k] = sortedPos;
+    order[sortedPos] = k;
+    return fill(sorted, sortedPos + 1, 2 * k + 1);
+}
+
+size_t FrozenIndex::lowerBound(uint32_t hash) const {
+    const uint32_t* keys = hashes.data();
+    size_t n = order.size();
+    size_t k = 1;
+    while (k <= n) {
+        __builtin_prefetch(keys + k * 16);
+        k = 2 * k + (keys[k] < hash);
+    }
+    return k >> __builtin_ffsll(~k);
+}
+
+uint32_t FrozenIndex::find(uint32_t hash, string_view name) const {
+    size_t k = lowerBound(hash);
+    if (k == 0 || hashes[k] != hash) {
+        return InodeTable::NO_INODE;
+    }
+    if (nameOf(inos[k]) == name) {
+        return inos[k];
+    }
+    for (size_t i = rank[k] + 1; i < order.size() && hashes[order[i]] == hash; i++) {
+        if (nameOf(inos[order[i]]) == name) {
+            return inos[order[i]];
+        }
+    }
+    return InodeTable::NO_INODE;
+}
+
+void FrozenIndex::collectAll(vector<InlineEntry>& result) const {
+    result.reserve(result.size() + order.size());
+    for (uint32_t k : order) {
+        result.push_back({hashes[k], inos[k]});
+    }
+}
+
+void FrozenIndex::collectAfter(uint32_t hash, string_view name, size_t limit,
+        vector<uint32_t>& result) const {
+    size_t k = lowerBound(hash);
+    size_t i = k == 0 ? order.size() : rank[k];
+    while (i < order.size() && hashes[order[i]] == hash && nameOf(inos[order[i]]) <= name) {
+        i++;
+    }
+    for (; i < order.size() && result.size() < limit; i++) {
+        result.push_back(inos[order[i]]);
+    }
+}
+
+size_t FrozenIndex::size() const {
+    return order.size();
+}
+
+size_t FrozenIndex::memoryUsage() const {
+    return (hashes.capacity() + inos.capacity() + rank.capacity() + order.capacity()) * sizeof(uint32_t);
+}
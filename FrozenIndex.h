@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+using namespace std;
+
+class InodeTable;
+struct InlineEntry;
+
+class FrozenIndex {
+    private:
+        const InodeTable* table;
+        vector<uint32_t> hashes;
+        vector<uint32_t> inos;
+        vector<uint32_t> rank;
+        vector<uint32_t> order;
+
+        string_view nameOf(uint32_t ino) const;
+        size_t fill(const vector<InlineEntry>& sorted, size_t sortedPos, size_t k);
+        size_t lowerBound(uint32_t hash) const;
+
+    public:
+        FrozenIndex(const vector<InlineEntry>& sorted, const InodeTable* table);
+
+        uint32_t find(uint32_t hash, string_view name) const;
+        void collectAll(vector<InlineEntry>& result) const;
+        void collectAfter(uint32_t hash, string_view name, size_t limit,
+                vector<uint32_t>& result) const;
+        size_t size() const;
+        size_t memoryUsage() const;
+};
@@ -0,0 +1,120 @@
+#include "InodeTable.h"
+#include "AVLHTree.h"
+#include "Epoch.h"
+#include "NameArena.h"
+#include <stdexcept>
+
+using namespace std;
+
+InodeTable::InodeTable(NameArena* arena)
+    : arena(arena ? arena : &NameArena::global()), liveCount(0), birthEpoch(0) {
+#ifdef FS_CONCURRENT
+    chunks.reserve(MAX_CHUNKS);
+#endif
+}
+
+InodeTable::~InodeTable() {
+    EpochReclaimer::discard(this);
+}
+
+NodePtr InodeTable::create(string_view name, NodeType type, FSNode* parent) {
+    uint32_t ino;
+    {
+        WriteLock guard(tableLock);
+        if (!freeSlots.empty()) {
+            ino = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            ino = generations.size();
+            if (ino % CHUNK_SLOTS == 0) {
+#ifdef FS_CONCURRENT
+                if (chunks.size() == MAX_CHUNKS) {
+                    throw length_error("inode table is full");
+                }
+#endif
+                chunks.emplace_back(new unsigned char[CHUNK_SLOTS * sizeof(FSNode)]);
+            }
+            generations.push_back(0);
+            births.push_back(0);
+        }
+        births[ino] = birthEpoch;
+        liveCount++;
+    }
+
+    FSNode* node = new (at(ino)) FSNode(name, type, parent, this, ino);
+    return NodePtr(node);
+}
+
+void InodeTable::destroy(uint32_t ino) {
+    {
+        WriteLock guard(tableLock);
+        generations[ino]++;
+    }
+    string_view name = at(ino)->name;
+    at(ino)->~FSNode();
+    arena->release(name);
+    {
+        WriteLock guard(tableLock);
+        liveCount--;
+    }
+    EpochReclaimer::retire(this, ino, [](void* owner, uintptr_t slot) {
+        InodeTable* table = static_cast<InodeTable*>(owner);
+        WriteLock guard(table->tableLock);
+        table->freeSlots.push_back(slot);
+    });
+}
+
+InodeRef InodeTable::ref(const FSNode* node) const {
+    ReadLock guard(tableLock);
+    return {node->ino, generations[node->ino]};
+}
+
+NodePtr InodeTable::resolve(InodeRef ref) const {
+    ReadLock guard(tableLock);
+    if (ref.ino >= generations.size() || generations[ref.ino] != ref.generation) {
+        return nullptr;
+    }
+    FSNode* node = at(ref.ino);
+    return node->tryRetain() ? NodePtr(node, adopt_lock) : nullptr;
+}
+
+void InodeTable::lockAllStripes() {
+    for (auto& stripe : stripes) {
+        stripe.lock();
+    }
+}
+
+void InodeTable::unlockAllStripes() {
+    for (uint32_t i = LOCK_STRIPES; i-- > 0;) {
+        stripes[i].unlock();
+    }
+}
+
+uint32_t InodeTable::birthOf(uint32_t ino) const {
+    ReadLock guard(tableLock);
+    return births[ino];
+}
+
+uint32_t InodeTable::advanceEpoch() {
+    WriteLock guard(tableLock);
+    return ++birthEpoch;
+}
+
+size_t InodeTable::size() const {
+    return liveCount;
+}
+
+size_t InodeTable::capacity() const {
+    return generations.size();
+}
+
+size_t InodeTable::memoryUsage() const {
+    return chunks.size() * CHUNK_SLOTS * sizeof(FSNode)
+        + chunks.capacity() * sizeof(unique_ptr<unsigned char[]>)
+        + (generations.capacity() + births.capacity() + freeSlots.capacity()) * sizeof(uint32_t);
+}
+
+InodeTable& InodeTable::global() {
+    static InodeTable* table = new InodeTable();
+    return *table;
+}
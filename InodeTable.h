@@ -0,0 +1,68 @@
+#pragma once
+
+#include "NodeLock.h"
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+class FSNode;
+class NodePtr;
+class NameArena;
+enum class NodeType : uint8_t;
+
+struct InodeRef {
+    uint32_t ino;
+    uint32_t generation;
+};
+
+class InodeTable {
+    private:
+        static constexpr uint32_t CHUNK_SLOTS = 1024;
+        static constexpr uint32_t MAX_CHUNKS = 65536;
+        static constexpr uint32_t LOCK_STRIPES = 1024;
+
+        NameArena* arena;
+        vector<unique_ptr<unsigned char[]>> chunks;
+        vector<uint32_t> generations;
+        vector<uint32_t> births;
+        vector<uint32_t> freeSlots;
+        size_t liveCount;
+        uint32_t birthEpoch;
+        mutable NodeMutex tableLock;
+        mutable NodeMutex stripes[LOCK_STRIPES];
+        atomic<uint64_t> versions[LOCK_STRIPES]{};
+
+    public:
+        static constexpr uint32_t NO_INODE = UINT32_MAX;
+
+        explicit InodeTable(NameArena* arena = nullptr);
+        ~InodeTable();
+        InodeTable(const InodeTable&) = delete;
+        InodeTable& operator=(const InodeTable&) = delete;
+
+        NodePtr create(string_view name, NodeType type, FSNode* parent = nullptr);
+        void destroy(uint32_t ino);
+        FSNode* at(uint32_t ino) const;
+        NameArena& names() const { return *arena; }
+        InodeRef ref(const FSNode* node) const;
+        NodePtr resolve(InodeRef ref) const;
+        static uint32_t stripeOf(uint32_t ino) { return ino % LOCK_STRIPES; }
+        NodeMutex& stripeLock(uint32_t stripe) const { return stripes[stripe]; }
+        NodeMutex& lockOf(uint32_t ino) const { return stripes[stripeOf(ino)]; }
+        uint64_t versionOf(uint32_t ino) const { return versions[stripeOf(ino)].load(memory_order_acquire); }
+        void bumpVersion(uint32_t ino) { versions[stripeOf(ino)].fetch_add(1, memory_order_release); }
+        void lockAllStripes();
+        void unlockAllStripes();
+        uint32_t birthOf(uint32_t ino) const;
+        uint32_t advanceEpoch();
+        size_t size() const;
+        size_t capacity() const;
+        size_t memoryUsage() const;
+
+        static InodeTable& global();
+};
@@ -0,0 +1,129 @@
+#include "LookupTable.h"
+#include "AVLHTree.h"
+#include "Epoch.h"
+
+using namespace std;
+
+LookupSlots::LookupSlots(size_t capacity)
+    : mask(capacity - 1), shift(64), used(0), live(0), slots(new atomic<uint64_t>[capacity]) {
+    for (size_t c = capacity; c > 1; c >>= 1) {
+        shift--;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        slots[i].store(LookupTable::EMPTY, memory_order_relaxed);
+    }
+}
+
+size_t LookupSlots::start(uint32_t hash) const {
+    return shift == 64 ? 0 : (hash * 0x9e3779b97f4a7c15ULL) >> shift;
+}
+
+LookupTable::LookupTable() : current(nullptr) {}
+
+LookupTable::~LookupTable() {
+    delete current.load(memory_order_relaxed);
+}
+
+void LookupTable::place(LookupSlots* target, uint64_t value) {
+    size_t i = target->start(LookupTable::hashOf(value));
+    while (true) {
+        uint64_t seen = target->slots[i].load(memory_order_relaxed);
+        if (seen == EMPTY || inoOf(seen) == TOMBSTONE) {
+            if (seen == EMPTY) {
+                target->used++;
+            }
+            target->live++;
+            target->slots[i].store(value, memory_order_release);
+            return;
+        }
+        i = (i + 1) & target->mask;
+    }
+}
+
+void LookupTable::publish(LookupSlots* next) {
+    LookupSlots* old = current.exchange(next, memory_order_acq_rel);
+    if (old) {
+        EpochReclaimer::retire(old, 0, [](void* slots, uintptr_t) {
+            delete static_cast<LookupSlots*>(slots);
+        });
+    }
+}
+
+void LookupTable::rebuild(size_t expected) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    LookupSlots* next = new LookupSlots(capacity);
+    if (LookupSlots* old = current.load(memory_order_relaxed)) {
+        for (size_t i = 0; i <= old->mask; i++) {
+            uint64_t value = old->slots[i].load(memory_order_relaxed);
+            if (value != EMPTY && inoOf(value) != TOMBSTONE) {
+                place(next, value);
+            }
+        }
+    }
+    publish(next);
+}
+
+void LookupTable::insert(uint32_t hash, uint32_t ino) {
+    LookupSlots* slots = current.load(memory_order_relaxed);
+    if (!slots || (slots->used + 1) * 4 > (slots->mask + 1) * 3) {
+        rebuild((slots ? slots->live : 0) + 1);
+        slots = current.load(memory_order_relaxed);
+    }
+    place(slots, pack(hash, ino));
+}
+
+void LookupTable::erase(uint32_t hash, uint32_t ino) {
+    LookupSlots* slots = current.load(memory_order_relaxed);
+    if (!slots) return;
+    uint64_t value = pack(hash, ino);
+    for (size_t i = slots->start(hash);; i = (i + 1) & slots->mask) {
+        uint64_t seen = slots->slots[i].load(memory_order_relaxed);
+        if (seen == EMPTY) return;
+        if (seen == value) {
+            slots->slots[i].store(pack(hash, TOMBSTONE), memory_order_release);
+            slots->live--;
+            break;
+        }
+    }
+    if (slots->mask + 1 > MIN_CAPACITY && slots->live * 8 < slots->mask + 1) {
+        rebuild(slots->live);
+    }
+}
+
+void LookupTable::replace(uint32_t hash, uint32_t ino, uint32_t next) {
+    LookupSlots* slots = current.load(memory_order_relaxed);
+    if (!slots) return;
+    uint64_t value = pack(hash, ino);
+    for (size_t i = slots->start(hash);; i = (i + 1) & slots->mask) {
+        uint64_t seen = slots->slots[i].load(memory_order_relaxed);
+        if (seen == EMPTY) return;
+        if (seen == value) {
+            slots->slots[i].store(pack(hash, next), memory_order_release);
+            return;
+        }
+    }
+}
+
+void LookupTable::assign(const vector<InlineEntry>& entries) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < entries.size() * 2) {
+        capacity *= 2;
+    }
+    LookupSlots* next = new LookupSlots(capacity);
+    for (const auto& entry : entries) {
+        place(next, pack(entry.hash, entry.ino));
+    }
+    publish(next);
+}
+
+const LookupSlots* LookupTable::load() const {
+    return current.load(memory_order_acquire);
+}
+
+size_t LookupTable::memoryUsage() const {
+    const LookupSlots* slots = current.load(memory_order_relaxed);
+    return slots ? sizeof(LookupSlots) + (slots->mask + 1) * sizeof(uint64_t) : 0;
+}
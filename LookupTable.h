@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+struct InlineEntry;
+
+struct LookupSlots {
+    size_t mask;
+    int shift;
+    size_t used;
+    size_t live;
+    unique_ptr<atomic<uint64_t>[]> slots;
+
+    explicit LookupSlots(size_t capacity);
+    size_t start(uint32_t hash) const;
+};
+
+class LookupTable {
+    private:
+        atomic<LookupSlots*> current;
+
+        static void place(LookupSlots* target, uint64_t value);
+        void publish(LookupSlots* next);
+        void rebuild(size_t expected);
+
+    public:
+        static constexpr uint64_t EMPTY = UINT64_MAX;
+        static constexpr uint32_t TOMBSTONE = UINT32_MAX - 1;
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        static uint64_t pack(uint32_t hash, uint32_t ino) { return (uint64_t)hash << 32 | ino; }
+        static uint32_t hashOf(uint64_t value) { return value >> 32; }
+        static uint32_t inoOf(uint64_t value) { return (uint32_t)value; }
+
+        LookupTable();
+        ~LookupTable();
+        LookupTable(const LookupTable&) = delete;
+        LookupTable& operator=(const LookupTable&) = delete;
+
+        void insert(uint32_t hash, uint32_t ino);
+        void erase(uint32_t hash, uint32_t ino);
+        void replace(uint32_t hash, uint32_t ino, uint32_t next);
+        void assign(const vector<InlineEntry>& entries);
+        const LookupSlots* load() const;
+        size_t memoryUsage() const;
+};
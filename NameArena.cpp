@@ -0,0 +1,159 @@
+#include "NameArena.h"
+#include "Epoch.h"
+#include <cstring>
+
+using namespace std;
+
+NameArena::NameArena()
+    : chunkUsed(0), chunkCapacity(0), bytesReserved(0), slots(64, nullptr), count(0) {}
+
+NameArena::~NameArena() {
+    EpochReclaimer::discard(this);
+}
+
+size_t NameArena::slotHash(string_view name) {
+    uint64_t hash = 0;
+    for (char c : name) {
+        hash = hash * 31 + static_cast<unsigned char>(c);
+    }
+    return (hash * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+string_view NameArena::view(const char* record) {
+    uint32_t length;
+    memcpy(&length, record + sizeof(uint32_t), sizeof(length));
+    return string_view(record + HEADER, length);
+}
+
+char* NameArena::recordOf(string_view name) {
+    return const_cast<char*>(name.data()) - HEADER;
+}
+
+size_t NameArena::recordSize(size_t length) {
+    return (HEADER + length + ALIGN - 1) / ALIGN * ALIGN;
+}
+
+char* NameArena::store(string_view name) {
+    uint32_t length = name.size();
+    size_t needed = recordSize(length);
+    char* record;
+    auto reusable = freeRecords.find(needed);
+    if (reusable != freeRecords.end() && !reusable->second.empty()) {
+        record = reusable->second.back();
+        reusable->second.pop_back();
+    } else {
+        if (chunkUsed + needed > chunkCapacity) {
+            chunkCapacity = max(CHUNK_SIZE, needed);
+            chunks.push_back(make_unique<char[]>(chunkCapacity));
+            bytesReserved += chunkCapacity;
+            chunkUsed = 0;
+        }
+        record = chunks.back().get() + chunkUsed;
+        chunkUsed += needed;
+    }
+    uint32_t refs = 1;
+    memcpy(record, &refs, sizeof(refs));
+    memcpy(record + sizeof(refs), &length, sizeof(length));
+    memcpy(record + HEADER, name.data(), length);
+    return record;
+}
+
+void NameArena::grow() {
+    vector<char*> old(slots.size() * 2, nullptr);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (char* record : old) {
+        if (!record) continue;
+        size_t pos = slotHash(view(record)) & mask;
+        while (slots[pos]) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = record;
+    }
+}
+
+void NameArena::erase(size_t pos) {
+    size_t mask = slots.size() - 1;
+    slots[pos] = nullptr;
+    for (size_t next = (pos + 1) & mask; slots[next]; next = (next + 1) & mask) {
+        size_t home = slotHash(view(slots[next])) & mask;
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            slots[pos] = slots[next];
+            slots[next] = nullptr;
+            pos = next;
+        }
+    }
+}
+
+string_view NameArena::intern(string_view name) {
+    WriteLock guard(lock);
+    if ((count + 1) * 10 > slots.size() * 7) {
+        grow();
+    }
+    size_t mask = slots.size() - 1;
+    size_t pos = slotHash(name) & mask;
+    while (slots[pos]) {
+        string_view existing = view(slots[pos]);
+        if (existing == name) {
+            uint32_t refs;
+            memcpy(&refs, slots[pos], sizeof(refs));
+            refs++;
+            memcpy(slots[pos], &refs, sizeof(refs));
+            return existing;
+        }
+        pos = (pos + 1) & mask;
+    }
+    char* record = store(name);
+    slots[pos] = record;
+    count++;
+    return view(record);
+}
+
+string_view NameArena::retain(string_view name) {
+    WriteLock guard(lock);
+    char* record = recordOf(name);
+    uint32_t refs;
+    memcpy(&refs, record, sizeof(refs));
+    refs++;
+    memcpy(record, &refs, sizeof(refs));
+    return name;
+}
+
+void NameArena::release(string_view name) {
+    char* record = recordOf(name);
+    {
+        WriteLock guard(lock);
+        uint32_t refs;
+        memcpy(&refs, record, sizeof(refs));
+        if (--refs > 0) {
+            memcpy(record, &refs, sizeof(refs));
+            return;
+        }
+        size_t mask = slots.size() - 1;
+        size_t pos = slotHash(name) & mask;
+        while (slots[pos] != record) {
+            pos = (pos + 1) & mask;
+        }
+        erase(pos);
+        count--;
+    }
+    EpochReclaimer::retire(this, reinterpret_cast<uintptr_t>(record), [](void* owner, uintptr_t freed) {
+        NameArena* arena = static_cast<NameArena*>(owner);
+        char* record = reinterpret_cast<char*>(freed);
+        WriteLock guard(arena->lock);
+        arena->freeRecords[recordSize(view(record).size())].push_back(record);
+    });
+}
+
+size_t NameArena::size() const {
+    return count;
+}
+
+size_t NameArena::memoryUsage() const {
+    return bytesReserved + slots.capacity() * sizeof(char*);
+}
+
+NameArena& NameArena::global() {
+    static NameArena arena;
+    return arena;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "NodeLock.h"
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+class NameArena {
+    private:
+        static constexpr size_t CHUNK_SIZE = 64 * 1024;
+        static constexpr size_t HEADER = 2 * sizeof(uint32_t);
+        static constexpr size_t ALIGN = 8;
+
+        vector<unique_ptr<char[]>> chunks;
+        size_t chunkUsed;
+        size_t chunkCapacity;
+        size_t bytesReserved;
+        vector<char*> slots;
+        unordered_map<size_t, vector<char*>> freeRecords;
+        size_t count;
+        NodeMutex lock;
+
+        static size_t slotHash(string_view name);
+        static string_view view(const char* record);
+        static char* recordOf(string_view name);
+        static size_t recordSize(size_t length);
+        char* store(string_view name);
+        void grow();
+        void erase(size_t pos);
+
+    public:
+        NameArena();
+        ~NameArena();
+        NameArena(const NameArena&) = delete;
+        NameArena& operator=(const NameArena&) = delete;
+
+        string_view intern(string_view name);
+        string_view retain(string_view name);
+        void release(string_view name);
+        size_t size() const;
+        size_t memoryUsage() const;
+
+        static NameArena& global();
+};
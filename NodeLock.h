@@ -0,0 +1,20 @@
+#pragma once
+
+#include <mutex>
+#include <shared_mutex>
+
+using namespace std;
+
+#ifdef FS_CONCURRENT
+using NodeMutex = shared_mutex;
+#else
+struct NodeMutex {
+    void lock() {}
+    void unlock() {}
+    void lock_shared() {}
+    void unlock_shared() {}
+};
+#endif
+
+using ReadLock = shared_lock<NodeMutex>;
+using WriteLock = unique_lock<NodeMutex>;
@@ -0,0 +1,108 @@
+#include "Reclaimer.h"
+#include <thread>
+
+using namespace std;
+
+Reclaimer::Reclaimer(InodeTable& table) : table(table), outstanding(0) {
+#ifdef FS_CONCURRENT
+    stopping = false;
+    worker = thread(&Reclaimer::run, this);
+#endif
+}
+
+Reclaimer::~Reclaimer() {
+#ifdef FS_CONCURRENT
+    {
+        WriteLock guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+#else
+    drain();
+#endif
+}
+
+#ifdef FS_CONCURRENT
+void Reclaimer::run() {
+    WriteLock guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || !work.empty(); });
+        if (work.empty()) {
+            return;
+        }
+        guard.unlock();
+        step(BATCH);
+        this_thread::yield();
+        guard.lock();
+    }
+}
+#endif
+
+size_t Reclaimer::step(size_t budget) {
+    size_t processed = 0;
+    vector<NodePtr> children;
+    while (processed < budget) {
+        NodePtr node;
+        {
+            WriteLock guard(lock);
+            if (work.empty()) break;
+            node = move(work.back());
+            work.pop_back();
+        }
+
+        if (node->isDirectory() && node->useCount() == 1) {
+            {
+                WriteLock guard(table.lockOf(node->ino));
+                node->htree().detachAll(children);
+            }
+            for (const auto& child : children) {
+                WriteLock guard(table.lockOf(child->ino));
+                child->parent = nullptr;
+            }
+            outstanding += children.size();
+            WriteLock guard(lock);
+            for (auto& child : children) {
+                work.push_back(move(child));
+            }
+            children.clear();
+        }
+
+        node = nullptr;
+        outstanding--;
+        processed++;
+    }
+    return processed;
+}
+
+void Reclaimer::defer(NodePtr node) {
+    if (!node) return;
+    outstanding++;
+    {
+        WriteLock guard(lock);
+        work.push_back(move(node));
+    }
+#ifdef FS_CONCURRENT
+    wake.notify_one();
+#endif
+}
+
+void Reclaimer::poll() {
+#ifndef FS_CONCURRENT
+    if (outstanding > 0) {
+        step(BATCH);
+    }
+#endif
+}
+
+void Reclaimer::drain() {
+    while (outstanding > 0) {
+        if (step(BATCH) == 0) {
+            this_thread::yield();
+        }
+    }
+}
+
+size_t Reclaimer::pending() const {
+    return outstanding;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AVLHTree.h"
+#include "NodeLock.h"
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#ifdef FS_CONCURRENT
+#include <thread>
+#include <condition_variable>
+#endif
+
+using namespace std;
+
+class Reclaimer {
+    private:
+        static constexpr size_t BATCH = 1024;
+
+        InodeTable& table;
+        vector<NodePtr> work;
+        atomic<size_t> outstanding;
+        NodeMutex lock;
+#ifdef FS_CONCURRENT
+        condition_variable_any wake;
+        bool stopping;
+        thread worker;
+
+        void run();
+#endif
+
+        size_t step(size_t budget);
+
+    public:
+        explicit Reclaimer(InodeTable& table);
+        ~Reclaimer();
+        Reclaimer(const Reclaimer&) = delete;
+        Reclaimer& operator=(const Reclaimer&) = delete;
+
+        void defer(NodePtr node);
+        void poll();
+        void drain();
+        size_t pending() const;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+struct AtomicRefCount {
+    atomic<uint32_t> value{0};
+
+    void increment() { value.fetch_add(1, memory_order_relaxed); }
+    bool incrementIfLive() {
+        uint32_t current = value.load(memory_order_relaxed);
+        while (current != 0) {
+            if (value.compare_exchange_weak(current, current + 1, memory_order_acquire, memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool decrement() { return value.fetch_sub(1, memory_order_acq_rel) == 1; }
+    uint32_t load() const { return value.load(memory_order_acquire); }
+};
+
+struct PlainRefCount {
+    uint32_t value = 0;
+
+    void increment() { value++; }
+    bool incrementIfLive() { return value != 0 && ++value; }
+    bool decrement() { return --value == 0; }
+    uint32_t load() const { return value; }
+};
+
+#ifdef FS_CONCURRENT
+using RefCount = AtomicRefCount;
+#else
+using RefCount = PlainRefCount;
+#endif
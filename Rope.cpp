@@ -17,11 +17,15 @@ void print_error(const string& who, const string& msg) {
 
 RopeNode::RopeNode(const string& s)
     : weight(s.size()), height(1), text(s),
-    left(nullptr), right(nullptr) {}
+    left(nullptr), right(nullptr) {
+    refs.increment();
+}
 
 RopeNode::RopeNode()
     : weight(0), height(1), text(""),
-    left(nullptr), right(nullptr) {}
+    left(nullptr), right(nullptr) {
+    refs.increment();
+}
 
 bool RopeNode::isLeaf() const {
     return left == nullptr && right == nullptr;
@@ -52,33 +56,37 @@ void Rope::updateWeight(RopeNode* node) {
     }
 }
 
-RopeNode* Rope::copyNode(RopeNode* node) {
-    if (!node) return nullptr;
+RopeNode* Rope::retainNode(RopeNode* node) {
+    if (node) node->refs.increment();
+    return node;
+}
+
+void Rope::releaseNode(RopeNode* node) {
+    if (!node || !node->refs.decrement()) return;
+    releaseNode(node->left);
+    releaseNode(node->right);
+    delete node;
+}
+
+RopeNode* Rope::ownNode(RopeNode* node) {
+    if (!node || node->refs.load() == 1) return node;
 
     RopeNode* newNode = new RopeNode();
     newNode->weight = node->weight;
     newNode->height = node->height;
     newNode->text = node->text;
-    newNode->left = copyNode(node->left);
-    newNode->right = copyNode(node->right);
+    newNode->left = retainNode(node->left);
+    newNode->right = retainNode(node->right);
+    releaseNode(node);
 
     return newNode;
 }
 
-void Rope::deleteNode(RopeNode* node) {
-    if (!node) return;
-    deleteNode(node->left);
-    deleteNode(node->right);
-    delete node;
-}
-
 RopeNode* Rope::rightRotate(RopeNode* P) {
     if (!P || !P->left) return P; 
 
-    RopeNode* Q = P->left;
-
-    RopeNode* newP = copyNode(P);
-    RopeNode* newQ = copyNode(Q);
+    RopeNode* newP = ownNode(P);
+    RopeNode* newQ = ownNode(newP->left);
 
     newP->left = newQ->right;
     newQ->right = newP;
@@ -94,10 +102,8 @@ RopeNode* Rope::rightRotate(RopeNode* P) {
 RopeNode* Rope::leftRotate(RopeNode* P) {
     if (!P || !P->right) return P;
 
-    RopeNode* Q = P->right;
-
-    RopeNode* newP = copyNode(P);
-    RopeNode* newQ = copyNode(Q);
+    RopeNode* newP = ownNode(P);
+    RopeNode* newQ = ownNode(newP->right);
 
     newP->right = newQ->left;
     newQ->left = newP;
@@ -113,6 +119,7 @@ RopeNode* Rope::leftRotate(RopeNode* P) {
 RopeNode* Rope::balance(RopeNode* node) {
     if (!node) return node;
 
+    node = ownNode(node);
     updateHeight(node);
     updateWeight(node);
 
@@ -120,6 +127,7 @@ RopeNode* Rope::balance(RopeNode* node) {
 
     if (bf > 1) {
         if (getBalance(node->left) < 0) {
+            node = ownNode(node);
             node->left = leftRotate(node->left);
         }
         return rightRotate(node);
@@ -127,6 +135,7 @@ RopeNode* Rope::balance(RopeNode* node) {
 
     if (bf < -1) {
         if (getBalance(node->right) > 0) {
+            node = ownNode(node);
             node->right = rightRotate(node->right);
         }
         return leftRotate(node);
@@ -189,8 +198,8 @@ pair<RopeNode*, RopeNode*> Rope::splitNode(RopeNode* node, int index) {
     if (!node) return {nullptr, nullptr};
 
     if (node->isLeaf()) {
-        if (index <= 0) return { nullptr, copyNode(node) };
-        if ((size_t)index >= node->text.size()) return { copyNode(node), nullptr };
+        if (index <= 0) return { nullptr, retainNode(node) };
+        if ((size_t)index >= node->text.size()) return { retainNode(node), nullptr };
 
         RopeNode* left = new RopeNode(node->text.substr(0, index));
         RopeNode* right = new RopeNode(node->text.substr(index));
@@ -200,11 +209,11 @@ pair<RopeNode*, RopeNode*> Rope::splitNode(RopeNode* node, int index) {
 
     if (index <= node->weight) {
         auto [l1, l2] = splitNode(node->left, index);
-        RopeNode* right = concat(l2, copyNode(node->right));
+        RopeNode* right = concat(l2, retainNode(node->right));
         return {l1, right};
     } else {
         auto [r1, r2] = splitNode(node->right, index - node->weight);
-        RopeNode* left = concat(copyNode(node->left), r1);
+        RopeNode* left = concat(retainNode(node->left), r1);
         return { left, r2 };
     }
 }
@@ -217,20 +226,29 @@ Rope::Rope(const string& s) {
 
 Rope::Rope(RopeNode* node) : root(node) {}
 
-Rope::Rope(const Rope& other) : root(copyNode(other.root)) {}
+Rope::Rope(const Rope& other) : root(retainNode(other.root)) {}
 
 Rope::~Rope() {
-    deleteNode(root);
+    releaseNode(root);
 }
 
 Rope& Rope::operator=(const Rope& other) {
     if (this != &other) {
-        deleteNode(root);
-        root = copyNode(other.root);
+        RopeNode* old = root;
+        root = retainNode(other.root);
+        releaseNode(old);
     }
     return *this;
 }
 
+void Rope::swap(Rope& other) {
+    std::swap(root, other.root);
+}
+
+bool Rope::sharesWith(const Rope& other) const {
+    return root != nullptr && root == other.root;
+}
+
 void Rope::insert(int pos, const string& str) {
     if (str.empty()) return;
 
@@ -243,7 +261,7 @@ void Rope::insert(int pos, const string& str) {
     auto [l, r] = splitNode(root, pos);
     RopeNode* mid = buildFromString(str, 0, str.size());
 
-    deleteNode(root);
+    releaseNode(root);
     
     root = concat(concat(l, mid), r);
     printMessage("Rope", "Вставлено <" + str + "> на позицию" + to_string(pos));
@@ -273,9 +291,9 @@ bool Rope::deleteSubstring(const string& substr) {
     auto [l, tmp] = splitNode(oldRoot, pos);
     auto [mid, r] = splitNode(tmp, substr.length());
 
-    deleteNode(oldRoot);
-    deleteNode(tmp);
-    deleteNode(mid);
+    releaseNode(oldRoot);
+    releaseNode(tmp);
+    releaseNode(mid);
     
     root = concat(l, r);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "RefCount.h"
 #include <string>
 #include <utility>
 
@@ -11,6 +12,7 @@ struct RopeNode {
     string text;
     RopeNode* left;
     RopeNode* right;
+    RefCount refs;
 
     RopeNode(const string& s);
     RopeNode();
@@ -20,15 +22,16 @@ struct RopeNode {
 class Rope {
     private:
         RopeNode* root;
-        const int MAX_LEAF_SIZE = 8;
+        static constexpr int MAX_LEAF_SIZE = 8;
 
-        void deleteNode(RopeNode* node);
+        static RopeNode* retainNode(RopeNode* node);
+        static void releaseNode(RopeNode* node);
+        RopeNode* ownNode(RopeNode* node);
         int getHeight(RopeNode* n) const;
         int getBalance(RopeNode* node) const;
         void updateHeight(RopeNode* node);
         int getLength(RopeNode* node) const;
         void updateWeight(RopeNode* node);
-        RopeNode* copyNode(RopeNode* node);
         RopeNode* rightRotate(RopeNode* P);
         RopeNode* leftRotate(RopeNode* P);
         RopeNode* balance(RopeNode* node);
@@ -45,6 +48,8 @@ class Rope {
         Rope(const Rope& other);
         ~Rope();
         Rope& operator=(const Rope& other);
+        void swap(Rope& other);
+        bool sharesWith(const Rope& other) const;
 
         void insert(int pos, const string& str);
         int find(const string& substr) const;
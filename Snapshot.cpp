@@ -0,0 +1,101 @@
+#include "Snapshot.h"
+#include <algorithm>
+
+using namespace std;
+
+static bool entryLess(const PreservedEntry& a, const PreservedEntry& b) {
+    if (a.hash != b.hash) return a.hash < b.hash;
+    return a.name < b.name;
+}
+
+void PreservedNode::capture(const FSNode* node) {
+    permissions = node->permissions;
+    if (node->isFile()) {
+        content = node->content();
+    }
+}
+
+void PreservedNode::record(string_view name, uint32_t hash, const NodePtr& previous) {
+    PreservedEntry entry{hash, string(name), previous};
+    auto it = lower_bound(changes.begin(), changes.end(), entry, entryLess);
+    if (it != changes.end() && it->hash == hash && it->name == name) {
+        return;
+    }
+    changes.insert(it, move(entry));
+}
+
+const PreservedEntry* PreservedNode::findChange(string_view name, uint32_t hash) const {
+    auto it = lower_bound(changes.begin(), changes.end(), hash,
+        [](const PreservedEntry& change, uint32_t h) { return change.hash < h; });
+    for (; it != changes.end() && it->hash == hash; ++it) {
+        if (it->name == name) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+void NodeView::capture(const FSNode* node, const PreservedNode* kept) {
+    permissions = kept ? kept->permissions : node->permissions;
+    if (node->isFile()) {
+        content = kept ? kept->content : node->content();
+        return;
+    }
+    for (auto& child : node->getChildren()) {
+        if (!kept || !kept->findChange(child->name, child->nameHash)) {
+            children.push_back({child->nameHash, string(child->name), move(child)});
+        }
+    }
+    if (kept) {
+        for (const auto& change : kept->changes) {
+            if (change.node) {
+                children.push_back(change);
+            }
+        }
+    }
+}
+
+Snapshot::Snapshot(const string& name, uint32_t epoch) : label(name), epoch(epoch) {}
+
+const string& Snapshot::name() const {
+    return label;
+}
+
+bool Snapshot::covers(uint32_t birth) const {
+    return birth < epoch;
+}
+
+bool Snapshot::preserve(const FSNode* node) {
+    auto [it, inserted] = preserved.try_emplace(node->ino);
+    if (!inserted) {
+        return false;
+    }
+    it->second.capture(node);
+    return true;
+}
+
+void Snapshot::preserve(const FSNode* dir, string_view name, uint32_t hash, const NodePtr& previous) {
+    auto [it, inserted] = preserved.try_emplace(dir->ino);
+    if (inserted) {
+        it->second.capture(dir);
+    }
+    it->second.record(name, hash, previous);
+}
+
+const PreservedNode* Snapshot::find(uint32_t ino) const {
+    auto it = preserved.find(ino);
+    return it == preserved.end() ? nullptr : &it->second;
+}
+
+size_t Snapshot::preservedCount() const {
+    return preserved.size();
+}
+
+void Snapshot::takeNodes(vector<NodePtr>& result) {
+    for (auto& [ino, node] : preserved) {
+        for (auto& entry : node.changes) {
+            result.push_back(move(entry.node));
+        }
+    }
+    preserved.clear();
+}
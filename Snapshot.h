@@ -0,0 +1,57 @@
+#pragma once
+
+#include "AVLHTree.h"
+#include "Rope.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+struct PreservedEntry {
+    uint32_t hash;
+    string name;
+    NodePtr node;
+};
+
+struct PreservedNode {
+    Permissions permissions;
+    Rope content;
+    vector<PreservedEntry> changes;
+
+    void capture(const FSNode* node);
+    void record(string_view name, uint32_t hash, const NodePtr& previous);
+    const PreservedEntry* findChange(string_view name, uint32_t hash) const;
+};
+
+struct NodeView {
+    Permissions permissions;
+    Rope content;
+    vector<PreservedEntry> children;
+
+    void capture(const FSNode* node, const PreservedNode* kept = nullptr);
+};
+
+class Snapshot {
+    private:
+        string label;
+        uint32_t epoch;
+        unordered_map<uint32_t, PreservedNode> preserved;
+
+    public:
+        static constexpr string_view MOUNT = ".snapshots";
+
+        Snapshot(const string& name, uint32_t epoch);
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        const string& name() const;
+        bool covers(uint32_t birth) const;
+        bool preserve(const FSNode* node);
+        void preserve(const FSNode* dir, string_view name, uint32_t hash, const NodePtr& previous);
+        const PreservedNode* find(uint32_t ino) const;
+        size_t preservedCount() const;
+        void takeNodes(vector<NodePtr>& result);
+};
@@ -0,0 +1,249 @@
+#include "Transaction.h"
+#include "FileSystem.h"
+#include <iostream>
+
+using namespace std;
+
+Transaction::Transaction(FileSystem* fs) : fs(fs), base(fs->getCurrentPath()), active(true) {}
+
+string Transaction::normalize(const string& path) const {
+    vector<string_view> components;
+    string full = path.empty() || path[0] == '/' ? path : base + "/" + path;
+    size_t next = 0;
+    while (next < full.size()) {
+        size_t end = full.find('/', next);
+        if (end == string::npos) {
+            end = full.size();
+        }
+        string_view component = string_view(full).substr(next, end - next);
+        next = end + 1;
+        if (component.empty() || component == ".") {
+            continue;
+        }
+        if (component == "..") {
+            if (!components.empty()) {
+                components.pop_back();
+            }
+            continue;
+        }
+        components.push_back(component);
+    }
+
+    string key;
+    for (string_view component : components) {
+        key += '/';
+        key += component;
+    }
+    return key;
+}
+
+const Transaction::PendingOp* Transaction::pendingFor(const string& key) const {
+    auto it = writes.find(key);
+    return it == writes.end() ? nullptr : &it->second;
+}
+
+bool Transaction::removedAncestor(const string& key) const {
+    for (size_t pos = key.find('/', 1); pos != string::npos; pos = key.find('/', pos + 1)) {
+        const PendingOp* op = pendingFor(key.substr(0, pos));
+        if (op && op->kind == OpKind::REMOVE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+NodePtr Transaction::trackedWalk(const string& key, PathComponent* leaf) {
+    NodePtr current = fs->root;
+    PathIterator it(key);
+    if (leaf && it.done()) {
+        return nullptr;
+    }
+    for (; !it.done(); ++it) {
+        if (!current->isDirectory()) {
+            return nullptr;
+        }
+        if (leaf && it.isLast()) {
+            *leaf = *it;
+            return current;
+        }
+        reads.push_back({current->ino, fs->inodes.versionOf(current->ino)});
+        current = current->findChild(it->name, it->hash);
+        if (!current) {
+            return nullptr;
+        }
+    }
+    return current;
+}
+
+bool Transaction::validate() const {
+    for (const auto& stamp : reads) {
+        if (fs->inodes.versionOf(stamp.ino) != stamp.version) {
+            return false;
+        }
+    }
+    return true;
+}
+
+string Transaction::read(const string& path) {
+    if (!active) return "";
+    string key = normalize(path);
+    if (removedAncestor(key)) {
+        return "";
+    }
+    if (const PendingOp* op = pendingFor(key)) {
+        return op->kind == OpKind::WRITE ? op->content : "";
+    }
+
+    NodePtr node = trackedWalk(key);
+    if (!node || !node->isFile()) {
+        return "";
+    }
+    ReadLock guard(fs->lockOf(node));
+    reads.push_back({node->ino, fs->inodes.versionOf(node->ino)});
+    return node->content().toString();
+}
+
+bool Transaction::readOnly(const string& key, const string& path) {
+    if (!FileSystem::isSnapshotPath(key)) {
+        return false;
+    }
+    cout << "Ошибка: " << path << ": Файловая система только для чтения" << endl;
+    abort();
+    return true;
+}
+
+void Transaction::write(const string& path, const string& content) {
+    if (!active) return;
+    string key = normalize(path);
+    if (readOnly(key, path)) return;
+    writes[key] = {OpKind::WRITE, content};
+}
+
+void Transaction::remove(const string& path) {
+    if (!active) return;
+    string key = normalize(path);
+    if (readOnly(key, path)) return;
+    writes[key] = {OpKind::REMOVE, ""};
+}
+
+bool Transaction::commit() {
+    if (!active) return false;
+    active = false;
+
+    struct Step {
+        const string* key;
+        const PendingOp* op;
+        PathComponent leaf;
+        NodePtr parent;
+        NodePtr target;
+        Rope content;
+        NodePtr up;
+        Usage delta;
+    };
+    vector<Step> steps;
+    steps.reserve(writes.size());
+
+    for (const auto& [key, op] : writes) {
+        if (removedAncestor(key)) {
+            return false;
+        }
+        steps.push_back({&key, &op, {}, nullptr, nullptr, Rope(), nullptr, Usage()});
+        Step& step = steps.back();
+        step.parent = trackedWalk(key, &step.leaf);
+        if (!step.parent || fs->isMountEntry(step.parent, step.leaf.name) || !fs->checkWritePermission(step.parent)) {
+            return false;
+        }
+        step.target = fs->step(step.parent, step.leaf);
+        if (op.kind == OpKind::WRITE) {
+            if (step.target && (!step.target->isFile() || !fs->checkWritePermission(step.target))) {
+                return false;
+            }
+            Rope content(op.content);
+            step.content.swap(content);
+        } else if (!step.target) {
+            return false;
+        }
+    }
+
+    map<uint32_t, bool> stripes;
+    for (const auto& step : steps) {
+        stripes[InodeTable::stripeOf(step.parent->ino)] = true;
+        if (step.target) {
+            stripes[InodeTable::stripeOf(step.target->ino)] = true;
+        }
+    }
+    for (const auto& stamp : reads) {
+        stripes.emplace(InodeTable::stripeOf(stamp.ino), false);
+    }
+
+    for (const auto& [stripe, exclusive] : stripes) {
+        NodeMutex& lock = fs->inodes.stripeLock(stripe);
+        exclusive ? lock.lock() : lock.lock_shared();
+    }
+
+    bool valid = validate();
+    for (const auto& step : steps) {
+        if (!valid) break;
+        valid = step.parent->findChild(step.leaf.name, step.leaf.hash) == step.target;
+    }
+
+    if (valid) {
+        for (auto& step : steps) {
+            if (step.op->kind == OpKind::REMOVE) {
+                fs->preserve(step.parent, step.leaf.name, step.leaf.hash, step.target);
+                step.parent->removeChild(step.leaf.name, step.leaf.hash);
+                fs->inodes.bumpVersion(step.parent->ino);
+                step.up = step.parent;
+                step.delta = -fs->detachUsage(step.target);
+            } else if (step.target) {
+                fs->preserve(step.target);
+                int before = step.target->content().length();
+                step.target->content().swap(step.content);
+                fs->inodes.bumpVersion(step.target->ino);
+                step.up = fs->usageParent(step.target);
+                step.delta = {step.target->content().length() - before, 0, 0};
+                step.target = nullptr;
+            } else {
+                step.target = fs->inodes.create(step.leaf.name, NodeType::FILE, step.parent.get());
+                step.target->content().swap(step.content);
+                step.up = step.parent;
+                step.delta = step.target->usage();
+                fs->preserve(step.parent, step.leaf.name, step.leaf.hash, nullptr);
+                step.parent->addChild(step.target, true);
+                fs->inodes.bumpVersion(step.parent->ino);
+            }
+        }
+    }
+
+    for (auto it = stripes.rbegin(); it != stripes.rend(); ++it) {
+        NodeMutex& lock = fs->inodes.stripeLock(it->first);
+        it->second ? lock.unlock() : lock.unlock_shared();
+    }
+
+    if (valid) {
+        for (auto& step : steps) {
+            fs->account(move(step.up), step.delta);
+            if (step.target) {
+                fs->invalidatePath(step.target.get());
+            }
+            if (step.op->kind == OpKind::REMOVE && step.target->isDirectory()) {
+                fs->reclaimer.defer(move(step.target));
+            }
+        }
+    }
+    return valid;
+}
+
+void Transaction::abort() {
+    active = false;
+    writes.clear();
+    reads.clear();
+}
+
+bool Transaction::isActive() const {
+    return active;
+}
+
+size_t Transaction::pendingCount() const {
+    return writes.size();
+}
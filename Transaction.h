@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+using namespace std;
+
+class FileSystem;
+class NodePtr;
+struct PathComponent;
+
+class Transaction {
+    private:
+        enum class OpKind {
+            WRITE,
+            REMOVE
+        };
+
+        struct PendingOp {
+            OpKind kind;
+            string content;
+        };
+
+        struct ReadStamp {
+            uint32_t ino;
+            uint64_t version;
+        };
+
+        FileSystem* fs;
+        string base;
+        map<string, PendingOp> writes;
+        vector<ReadStamp> reads;
+        bool active;
+
+        string normalize(const string& path) const;
+        const PendingOp* pendingFor(const string& key) const;
+        bool removedAncestor(const string& key) const;
+        bool readOnly(const string& key, const string& path);
+        NodePtr trackedWalk(const string& key, PathComponent* leaf = nullptr);
+        bool validate() const;
+
+    public:
+        explicit Transaction(FileSystem* fs);
+
+        // Optimistic concurrency control, not MVCC or snapshot isolation.
+        // Reads see the live tree, not a snapshot taken at begin, so two reads
+        // may observe different points in time; every read records the
+        // versions it depended on and commit() fails if any of them changed.
+        // commit() holds exclusive stripe locks on everything it writes while
+        // applying, so plain readers of those inodes wait for it.
+        string read(const string& path);
+        void write(const string& path, const string& content);
+        void remove(const string& path);
+        bool commit();
+        void abort();
+        bool isActive() const;
+        size_t pendingCount() const;
+};
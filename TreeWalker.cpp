@@ -0,0 +1,118 @@
+#include "TreeWalker.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+TreeWalker::TreeWalker(const InodeTable& table, size_t threads) : table(table), threads(max<size_t>(threads, 1)) {
+#ifndef FS_CONCURRENT
+    this->threads = 1;
+#endif
+}
+
+bool TreeWalker::take(vector<Worker>& workers, size_t self, Task& task) const {
+    {
+        Worker& mine = workers[self];
+        WriteLock guard(mine.lock);
+        if (!mine.tasks.empty()) {
+            task = move(mine.tasks.back());
+            mine.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < workers.size(); offset++) {
+        Worker& victim = workers[(self + offset) % workers.size()];
+        WriteLock guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TreeWalker::expand(Worker& worker, Task& task, const Predicate& match,
+                        vector<FSNode*>& children, vector<Task>& spawned, atomic<size_t>& pending) const {
+    children.clear();
+    {
+        ReadLock guard(table.lockOf(task.dir->ino));
+        task.dir->appendChildren(children);
+        for (uint32_t i = 0; i < children.size(); i++) {
+            FSNode* child = children[i];
+            if (match(child->name)) {
+                worker.hits.push_back({task.frame, string(child->name), i});
+            }
+            if (child->isDirectory() && child->tryRetain()) {
+                worker.frames.push_back({task.frame, string(child->name), i});
+                spawned.push_back({NodePtr(child, adopt_lock), &worker.frames.back()});
+            }
+        }
+    }
+    task.dir = nullptr;
+
+    if (spawned.empty()) return;
+    pending += spawned.size();
+    WriteLock guard(worker.lock);
+    for (auto& next : spawned) {
+        worker.tasks.push_back(move(next));
+    }
+    spawned.clear();
+}
+
+void TreeWalker::run(vector<Worker>& workers, size_t self, const Predicate& match, atomic<size_t>& pending) const {
+    vector<FSNode*> children;
+    vector<Task> spawned;
+    Task task;
+    while (pending > 0) {
+        if (!take(workers, self, task)) {
+            this_thread::yield();
+            continue;
+        }
+        expand(workers[self], task, match, children, spawned, pending);
+        pending--;
+    }
+}
+
+vector<string> TreeWalker::collect(const NodePtr& start, const string& prefix, const Predicate& match) const {
+    vector<Worker> workers(threads);
+    atomic<size_t> pending(1);
+    workers[0].tasks.push_back({start, nullptr});
+
+    vector<thread> helpers;
+    for (size_t i = 1; i < threads; i++) {
+        helpers.emplace_back(&TreeWalker::run, this, ref(workers), i, cref(match), ref(pending));
+    }
+    run(workers, 0, match, pending);
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    vector<pair<vector<uint32_t>, string>> found;
+    vector<string_view> names;
+    for (const auto& worker : workers) {
+        for (const auto& hit : worker.hits) {
+            vector<uint32_t> key = {hit.index};
+            names.assign({hit.name});
+            for (const Frame* frame = hit.frame; frame; frame = frame->up) {
+                key.push_back(frame->index);
+                names.push_back(frame->name);
+            }
+            reverse(key.begin(), key.end());
+            string path = prefix;
+            for (auto it = names.rbegin(); it != names.rend(); ++it) {
+                path += '/';
+                path += *it;
+            }
+            found.emplace_back(move(key), move(path));
+        }
+    }
+    sort(found.begin(), found.end());
+
+    vector<string> result;
+    result.reserve(found.size());
+    for (auto& entry : found) {
+        result.push_back(move(entry.second));
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "AVLHTree.h"
+#include "NodeLock.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+class TreeWalker {
+    public:
+        using Predicate = function<bool(string_view)>;
+
+    private:
+        struct Frame {
+            const Frame* up;
+            string name;
+            uint32_t index;
+        };
+
+        struct Task {
+            NodePtr dir;
+            const Frame* frame;
+        };
+
+        struct Hit {
+            const Frame* frame;
+            string name;
+            uint32_t index;
+        };
+
+        struct Worker {
+            deque<Task> tasks;
+            deque<Frame> frames;
+            vector<Hit> hits;
+            NodeMutex lock;
+        };
+
+        const InodeTable& table;
+        size_t threads;
+
+        bool take(vector<Worker>& workers, size_t self, Task& task) const;
+        void expand(Worker& worker, Task& task, const Predicate& match,
+                    vector<FSNode*>& children, vector<Task>& spawned, atomic<size_t>& pending) const;
+        void run(vector<Worker>& workers, size_t self, const Predicate& match, atomic<size_t>& pending) const;
+
+    public:
+        TreeWalker(const InodeTable& table, size_t threads);
+
+        vector<string> collect(const NodePtr& start, const string& prefix, const Predicate& match) const;
+};
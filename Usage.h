@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+struct Usage {
+    int64_t bytes = 0;
+    int64_t files = 0;
+    int64_t dirs = 0;
+
+    Usage& operator+=(const Usage& other) {
+        bytes += other.bytes;
+        files += other.files;
+        dirs += other.dirs;
+        return *this;
+    }
+    Usage operator-() const { return {-bytes, -files, -dirs}; }
+    bool empty() const { return bytes == 0 && files == 0 && dirs == 0; }
+};
+
+struct AtomicUsage {
+    atomic<int64_t> bytes{0};
+    atomic<int64_t> files{0};
+    atomic<int64_t> dirs{0};
+
+    void add(const Usage& delta) {
+        bytes.fetch_add(delta.bytes, memory_order_relaxed);
+        files.fetch_add(delta.files, memory_order_relaxed);
+        dirs.fetch_add(delta.dirs, memory_order_relaxed);
+    }
+    Usage load() const {
+        return {bytes.load(memory_order_relaxed), files.load(memory_order_relaxed), dirs.load(memory_order_relaxed)};
+    }
+};
+
+struct PlainUsage {
+    Usage value;
+
+    void add(const Usage& delta) { value += delta; }
+    Usage load() const { return value; }
+};
+
+#ifdef FS_CONCURRENT
+using UsageCounter = AtomicUsage;
+#else
+using UsageCounter = PlainUsage;
+#endif
@@ -4,11 +4,37 @@
 #include <vector>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
 #include "AVLHTree.h"
+#include "FileSystem.h"
 
 using namespace std;
 using namespace chrono;
 
+static atomic<size_t> liveBytes(0);
+
+void* operator new(size_t size) {
+    char* block = static_cast<char*>(malloc(size + sizeof(max_align_t)));
+    if (!block) throw bad_alloc();
+    *reinterpret_cast<size_t*>(block) = size;
+    liveBytes += size;
+    return block + sizeof(max_align_t);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    char* block = static_cast<char*>(ptr) - sizeof(max_align_t);
+    liveBytes -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
 string randomString(int index) {
     static random_device rd;
     static mt19937 gen(42);
@@ -50,7 +76,7 @@ void benchmarkInsert(const string& outputFile) {
         auto startBest = high_resolution_clock::now();
         for (int i = 0; i < size; i++) {
             string name = optimalString(i);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeBest.insert(name, node);
         }
         auto endBest = high_resolution_clock::now();
@@ -65,7 +91,7 @@ void benchmarkInsert(const string& outputFile) {
         
         auto startAvg = high_resolution_clock::now();
         for (const auto& name : randomNames) {
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeAvg.insert(name, node);
         }
         auto endAvg = high_resolution_clock::now();
@@ -80,7 +106,7 @@ void benchmarkInsert(const string& outputFile) {
         
         auto startWorst = high_resolution_clock::now();
         for (const auto& name : collisionNames) {
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeWorst.insert(name, node);
         }
         auto endWorst = high_resolution_clock::now();
@@ -109,7 +135,7 @@ void benchmarkFind(const string& outputFile) {
         for (int i = 0; i < size; i++) {
             string name = optimalString(i);
             namesBest.push_back(name);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeBest.insert(name, node);
         }
         
@@ -125,7 +151,7 @@ void benchmarkFind(const string& outputFile) {
         for (int i = 0; i < size; i++) {
             string name = randomString(i);
             namesAvg.push_back(name);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeAvg.insert(name, node);
         }
         
@@ -141,7 +167,7 @@ void benchmarkFind(const string& outputFile) {
         for (int i = 0; i < size; i++) {
             string name = collisionString(i);
             namesWorst.push_back(name);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeWorst.insert(name, node);
         }
         
@@ -175,7 +201,7 @@ void benchmarkRemove(const string& outputFile) {
         for (int i = 0; i < size; i++) {
             string name = optimalString(i);
             namesBest.push_back(name);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeBest.insert(name, node);
         }
         
@@ -192,7 +218,7 @@ void benchmarkRemove(const string& outputFile) {
         for (int i = 0; i < size; i++) {
             string name = randomString(i);
             namesAvg.push_back(name);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeAvg.insert(name, node);
         }
         
@@ -212,7 +238,7 @@ void benchmarkRemove(const string& outputFile) {
         for (int i = 0; i < size; i++) {
             string name = collisionString(i);
             namesWorst.push_back(name);
-            auto node = make_shared<FSNode>(name, NodeType::FILE);
+            auto node = FSNode::create(name, NodeType::FILE);
             treeWorst.insert(name, node);
         }
         
@@ -231,7 +257,1240 @@ void benchmarkRemove(const string& outputFile) {
     cout << "Remove benchmark saved to " << outputFile << "\n\n";
 }
 
-int main() {
+void benchmarkSmallDirectories(const string& outputFile) {
+    vector<int> fanouts = {0, 1, 2, 4, 6, 8, 12, 16, 32};
+    const int dirCount = 10000;
+    ofstream out(outputFile);
+    out << "fanout,inline_bytes,tree_bytes,inline_find,tree_find\n";
+    
+    cout << "Benchmarking SMALL DIRECTORIES (inline vs AVL)...\n";
+    
+    for (int fanout : fanouts) {
+        cout << "  Fanout: " << fanout << "..." << flush;
+        
+        vector<string> names;
+        vector<NodePtr> children;
+        for (int i = 0; i < fanout; i++) {
+            names.push_back(randomString(i));
+            children.push_back(FSNode::create(names.back(), NodeType::FILE));
+        }
+        
+        double bytes[2];
+        double findTime[2];
+        for (int variant = 0; variant < 2; variant++) {
+            size_t limit = variant == 0 ? HTreeIndex::INLINE_LIMIT : 0;
+            
+            size_t before = liveBytes;
+            vector<HTreeIndex*> dirs;
+            dirs.reserve(dirCount);
+            size_t reserved = liveBytes - before;
+            for (int d = 0; d < dirCount; d++) {
+                HTreeIndex* dir = new HTreeIndex(limit);
+                for (int i = 0; i < fanout; i++) {
+                    dir->insert(names[i], children[i]);
+                }
+                dirs.push_back(dir);
+            }
+            bytes[variant] = (liveBytes - before - reserved) / (double)dirCount;
+            
+            int lookups = 0;
+            auto start = high_resolution_clock::now();
+            for (int rep = 0; rep < 10; rep++) {
+                for (HTreeIndex* dir : dirs) {
+                    for (int i = 0; i < fanout; i++) {
+                        lookups += dir->find(names[i]) != nullptr;
+                    }
+                }
+            }
+            auto end = high_resolution_clock::now();
+            findTime[variant] = lookups ? duration_cast<nanoseconds>(end - start).count() / (double)lookups : 0;
+            
+            for (HTreeIndex* dir : dirs) {
+                delete dir;
+            }
+        }
+        
+        out << fanout << "," << bytes[0] << "," << bytes[1] << "," 
+            << findTime[0] << "," << findTime[1] << "\n";
+        cout << " Done (" << bytes[0] << " vs " << bytes[1] << " bytes/dir)\n";
+    }
+    
+    out.close();
+    cout << "Small directories benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkBulkLoad(const string& outputFile) {
+    vector<int> sizes = {1000, 10000, 100000};
+    ofstream out(outputFile);
+    out << "size,insert,bulk_load,merge_insert,bulk_merge\n";
+    
+    cout << "Benchmarking BULK LOAD vs repeated INSERT...\n";
+    
+    for (int size : sizes) {
+        cout << "  Size: " << size << "..." << flush;
+        
+        vector<NodePtr> items;
+        for (int i = 0; i < size; i++) {
+            items.push_back(FSNode::create(randomString(i), NodeType::FILE));
+        }
+        int half = size / 2;
+        vector<NodePtr> secondHalf(items.begin() + half, items.end());
+        
+        HTreeIndex byInsert;
+        auto startInsert = high_resolution_clock::now();
+        for (const auto& item : items) {
+            byInsert.insert(item->name, item);
+        }
+        auto endInsert = high_resolution_clock::now();
+        
+        HTreeIndex byBulk;
+        auto bulkItems = items;
+        auto startBulk = high_resolution_clock::now();
+        byBulk.bulkLoad(move(bulkItems));
+        auto endBulk = high_resolution_clock::now();
+        
+        HTreeIndex mergeInsert;
+        HTreeIndex mergeBulk;
+        for (int i = 0; i < half; i++) {
+            mergeInsert.insert(items[i]->name, items[i]);
+            mergeBulk.insert(items[i]->name, items[i]);
+        }
+        auto startMergeInsert = high_resolution_clock::now();
+        for (const auto& item : secondHalf) {
+            mergeInsert.insert(item->name, item);
+        }
+        auto endMergeInsert = high_resolution_clock::now();
+        
+        auto startMergeBulk = high_resolution_clock::now();
+        mergeBulk.bulkLoad(move(secondHalf));
+        auto endMergeBulk = high_resolution_clock::now();
+        
+        double timeInsert = duration_cast<microseconds>(endInsert - startInsert).count() / 1000.0;
+        double timeBulk = duration_cast<microseconds>(endBulk - startBulk).count() / 1000.0;
+        double timeMergeInsert = duration_cast<microseconds>(endMergeInsert - startMergeInsert).count() / 1000.0;
+        double timeMergeBulk = duration_cast<microseconds>(endMergeBulk - startMergeBulk).count() / 1000.0;
+        
+        out << size << "," << timeInsert << "," << timeBulk << "," 
+            << timeMergeInsert << "," << timeMergeBulk << "\n";
+        cout << " Done (insert " << timeInsert << " ms, bulkLoad " << timeBulk << " ms)\n";
+    }
+    
+    out.close();
+    cout << "Bulk load benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkNegativeLookups(const string& outputFile) {
+    vector<int> sizes = {100, 1000, 10000, 100000};
+    const int lookups = 200000;
+    ofstream out(outputFile);
+    out << "size,plain,filtered,filter_bytes_per_entry,false_positive_rate\n";
+    
+    cout << "Benchmarking NEGATIVE LOOKUPS (Bloom filter)...\n";
+    
+    vector<string> absent;
+    for (int i = 0; i < lookups; i++) {
+        absent.push_back("missing_" + to_string(i) + ".tmp");
+    }
+    
+    for (int size : sizes) {
+        cout << "  Size: " << size << "..." << flush;
+        
+        HTreeIndex plain;
+        HTreeIndex filtered;
+        plain.setFilterEnabled(false);
+        BloomFilter standalone;
+        standalone.reset(size * 2);
+        for (int i = 0; i < size; i++) {
+            string name = randomString(i);
+            auto node = FSNode::create(name, NodeType::FILE);
+            plain.insert(name, node);
+            filtered.insert(name, node);
+            standalone.add(HashFunction::hash(name));
+        }
+        
+        int found = 0;
+        auto startPlain = high_resolution_clock::now();
+        for (const auto& name : absent) {
+            found += plain.find(name) != nullptr;
+        }
+        auto endPlain = high_resolution_clock::now();
+        
+        auto startFiltered = high_resolution_clock::now();
+        for (const auto& name : absent) {
+            found += filtered.find(name) != nullptr;
+        }
+        auto endFiltered = high_resolution_clock::now();
+        
+        int falsePositives = 0;
+        for (const auto& name : absent) {
+            falsePositives += standalone.mayContain(HashFunction::hash(name));
+        }
+        
+        double timePlain = duration_cast<nanoseconds>(endPlain - startPlain).count() / (double)lookups;
+        double timeFiltered = duration_cast<nanoseconds>(endFiltered - startFiltered).count() / (double)lookups;
+        double bytesPerEntry = filtered.filterMemoryUsage() / (double)size;
+        double fpRate = falsePositives / (double)lookups;
+        
+        out << size << "," << timePlain << "," << timeFiltered << "," 
+            << bytesPerEntry << "," << fpRate << "\n";
+        cout << " Done (" << timePlain << " -> " << timeFiltered << " ns" 
+             << (found ? ", unexpected hits" : "") << ")\n";
+    }
+    
+    out.close();
+    cout << "Negative lookup benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkLargeDirectories(const string& outputFile, bool huge) {
+    vector<int> sizes = {1000, 10000, 100000, 1000000};
+    if (huge) {
+        sizes.push_back(10000000);
+    }
+    const int lookups = 1000000;
+    ofstream out(outputFile);
+    out << "size,avl_find,btree_find,frozen_find,avl_bytes,btree_bytes,frozen_bytes\n";
+    
+    cout << "Benchmarking LARGE DIRECTORIES (AVL vs B+ tree vs frozen)...\n";
+    
+    for (int size : sizes) {
+        cout << "  Size: " << size << "..." << flush;
+        
+        vector<NodePtr> items;
+        items.reserve(size);
+        for (int i = 0; i < size; i++) {
+            items.push_back(FSNode::create("entry_" + to_string(i) + ".dat", NodeType::FILE));
+        }
+        vector<string> probes;
+        mt19937 gen(42);
+        for (int i = 0; i < lookups; i++) {
+            probes.push_back(string(items[gen() % size]->name));
+        }
+        
+        double findTime[3];
+        double bytes[3];
+        for (int variant = 0; variant < 3; variant++) {
+            size_t before = liveBytes;
+            HTreeIndex* index = variant == 1 ? new HTreeIndex(0, 0) : new HTreeIndex(0, SIZE_MAX);
+            index->setFilterEnabled(false);
+            index->bulkLoad(items);
+            if (variant == 2) {
+                index->freeze();
+            }
+            bytes[variant] = (liveBytes - before) / (double)size;
+            
+            int found = 0;
+            auto start = high_resolution_clock::now();
+            for (const auto& name : probes) {
+                found += index->find(name) != nullptr;
+            }
+            auto end = high_resolution_clock::now();
+            findTime[variant] = duration_cast<nanoseconds>(end - start).count() / (double)found;
+            delete index;
+        }
+        
+        out << size << "," << findTime[0] << "," << findTime[1] << "," << findTime[2] << "," 
+            << bytes[0] << "," << bytes[1] << "," << bytes[2] << "\n";
+        cout << " Done (AVL " << findTime[0] << " ns, B+ " << findTime[1] 
+             << " ns, frozen " << findTime[2] << " ns)\n";
+    }
+    
+    out.close();
+    cout << "Large directories benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkFindMany(const string& outputFile) {
+    vector<int> sizes = {1000, 10000, 100000, 1000000};
+    const int lookups = 1000000;
+    ofstream out(outputFile);
+    out << "size,find,find_many\n";
+    
+    cout << "Benchmarking BATCHED FIND (find vs findMany)...\n";
+    
+    for (int size : sizes) {
+        cout << "  Size: " << size << "..." << flush;
+        
+        vector<pair<string, NodePtr>> items;
+        items.reserve(size);
+        for (int i = 0; i < size; i++) {
+            string name = randomString(i);
+            items.push_back({name, FSNode::create(name, NodeType::FILE)});
+        }
+        vector<string> probes;
+        mt19937 gen(7);
+        for (int i = 0; i < lookups; i++) {
+            probes.push_back(items[gen() % size].first);
+        }
+        HTreeIndex index(0, SIZE_MAX);
+        index.setFilterEnabled(false);
+        for (auto& item : items) {
+            index.insert(item.first, item.second);
+        }
+        
+        int found = 0;
+        auto startSingle = high_resolution_clock::now();
+        for (const auto& name : probes) {
+            found += index.find(name) != nullptr;
+        }
+        auto endSingle = high_resolution_clock::now();
+        
+        auto startBatch = high_resolution_clock::now();
+        auto batch = index.findMany(probes);
+        auto endBatch = high_resolution_clock::now();
+        
+        double timeSingle = duration_cast<nanoseconds>(endSingle - startSingle).count() / (double)lookups;
+        double timeBatch = duration_cast<nanoseconds>(endBatch - startBatch).count() / (double)lookups;
+        
+        out << size << "," << timeSingle << "," << timeBatch << "\n";
+        cout << " Done (" << timeSingle << " -> " << timeBatch << " ns"
+             << (found != lookups || batch.size() != probes.size() ? ", missing hits" : "") << ")\n";
+    }
+    
+    out.close();
+    cout << "Batched find benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkNameStorage(const string& outputFile) {
+    const int dirCount = 1000;
+    const int filesPerDir = 100;
+    ofstream out(outputFile);
+    out << "workload,entries,bytes_per_entry,build_ms\n";
+    
+    cout << "Benchmarking NAME STORAGE (bytes per entry)...\n";
+    
+    for (int workload = 0; workload < 2; workload++) {
+        string label = workload == 0 ? "shared_names" : "unique_names";
+        cout << "  Workload: " << label << "..." << flush;
+        
+        size_t before = liveBytes;
+        auto start = high_resolution_clock::now();
+        FileSystem* fs = new FileSystem();
+        for (int d = 0; d < dirCount; d++) {
+            string dir = "/project_module_" + to_string(d);
+            fs->createDirectory(dir, true);
+            for (int i = 0; i < filesPerDir; i++) {
+                string file = workload == 0 
+                    ? "source_file_" + to_string(i) + ".cpp"
+                    : "module_" + to_string(d) + "_source_" + to_string(i) + ".cpp";
+                fs->createFile(dir + "/" + file, "", true);
+            }
+        }
+        auto end = high_resolution_clock::now();
+        int entries = dirCount * (filesPerDir + 1);
+        double bytesPerEntry = (liveBytes - before) / (double)entries;
+        double buildTime = duration_cast<microseconds>(end - start).count() / 1000.0;
+        delete fs;
+        
+        out << label << "," << entries << "," << bytesPerEntry << "," << buildTime << "\n";
+        cout << " Done (" << bytesPerEntry << " bytes/entry)\n";
+    }
+    
+    out.close();
+    cout << "Name storage benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkDeepPaths(const string& outputFile) {
+    vector<int> depths = {1, 2, 4, 8, 16, 32, 64};
+    const int lookups = 200000;
+    ofstream out(outputFile);
+    out << "depth,lookup_ns,create_remove_ns,write_rm_ns,cd_parent_ns,relative_ns\n";
+    
+    cout << "Benchmarking DEEP PATH lookups...\n";
+    
+    for (int depth : depths) {
+        cout << "  Depth: " << depth << "..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        cout.clear();
+        string dir;
+        for (int i = 0; i < depth; i++) {
+            dir += "/directory_level_" + to_string(i);
+            fs.createDirectory(dir, true);
+            for (int j = 0; j < 20; j++) {
+                fs.createFile(dir + "/sibling_" + to_string(j), "", true);
+            }
+        }
+        string file = dir + "/target_file.txt";
+        fs.createFile(file, "x", true);
+        
+        size_t found = 0;
+        auto startLookup = high_resolution_clock::now();
+        for (int i = 0; i < lookups; i++) {
+            found += fs.readFile(file).size();
+        }
+        auto endLookup = high_resolution_clock::now();
+        
+        const int cycles = 20000;
+        string temp = dir + "/temporary_entry.tmp";
+        cout.setstate(ios::failbit);
+        auto startChurn = high_resolution_clock::now();
+        for (int i = 0; i < cycles; i++) {
+            fs.createFile(temp, "", true);
+            fs.remove(temp);
+        }
+        auto endChurn = high_resolution_clock::now();
+        
+        auto startWrite = high_resolution_clock::now();
+        for (int i = 0; i < cycles; i++) {
+            fs.writeFile(temp, "y");
+            fs.rm(temp);
+        }
+        auto endWrite = high_resolution_clock::now();
+        
+        string leaf = "directory_level_" + to_string(depth - 1);
+        string relative;
+        for (int i = 0; i < depth; i++) {
+            relative += "../";
+        }
+        relative += file.substr(1);
+        fs.changeDirectory(dir);
+        auto startParent = high_resolution_clock::now();
+        for (int i = 0; i < cycles; i++) {
+            fs.changeDirectory("..");
+            fs.changeDirectory(leaf);
+        }
+        auto endParent = high_resolution_clock::now();
+        
+        size_t relativeFound = 0;
+        auto startRelative = high_resolution_clock::now();
+        for (int i = 0; i < cycles; i++) {
+            relativeFound += fs.findInFile(relative, "x") == 0;
+        }
+        auto endRelative = high_resolution_clock::now();
+        cout.clear();
+        
+        double lookupTime = duration_cast<nanoseconds>(endLookup - startLookup).count() / (double)lookups;
+        double churnTime = duration_cast<nanoseconds>(endChurn - startChurn).count() / (double)cycles;
+        double writeTime = duration_cast<nanoseconds>(endWrite - startWrite).count() / (double)cycles;
+        double parentTime = duration_cast<nanoseconds>(endParent - startParent).count() / (double)cycles;
+        double relativeTime = duration_cast<nanoseconds>(endRelative - startRelative).count() / (double)cycles;
+        
+        out << depth << "," << lookupTime << "," << churnTime << "," << writeTime << ","
+            << parentTime << "," << relativeTime << "\n";
+        cout << " Done (" << lookupTime << " ns/lookup"
+             << (found != (size_t)lookups || relativeFound != (size_t)cycles ? ", missing" : "") << ")\n";
+    }
+    
+    out.close();
+    cout << "Deep path benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkNodeFootprint(const string& outputFile, bool huge) {
+    vector<int> sizes = {100000, 1000000};
+    if (huge) {
+        sizes.push_back(10000000);
+    }
+    const int filesPerDir = 1000;
+    ofstream out(outputFile);
+    out << "nodes,sizeof_node,bytes_per_node,build_ms\n";
+    
+    cout << "Benchmarking NODE FOOTPRINT (sizeof(FSNode) = " << sizeof(FSNode) << ")...\n";
+    
+    vector<string> fileNames;
+    for (int i = 0; i < filesPerDir; i++) {
+        fileNames.push_back("file_" + to_string(i) + ".txt");
+    }
+    
+    for (int size : sizes) {
+        cout << "  Nodes: " << size << "..." << flush;
+        
+        size_t before = liveBytes;
+        auto start = high_resolution_clock::now();
+        InodeTable table;
+        auto root = table.create("", NodeType::DIRECTORY);
+        int created = 1;
+        for (int d = 0; created < size; d++) {
+            auto dir = table.create("dir_" + to_string(d), NodeType::DIRECTORY, root.get());
+            root->addChild(dir, true);
+            created++;
+            for (int i = 0; i < filesPerDir && created < size; i++) {
+                dir->addChild(table.create(fileNames[i], NodeType::FILE, dir.get()), true);
+                created++;
+            }
+        }
+        auto end = high_resolution_clock::now();
+        double bytesPerNode = (liveBytes - before) / (double)created;
+        double buildTime = duration_cast<milliseconds>(end - start).count();
+        root = nullptr;
+        
+        out << created << "," << sizeof(FSNode) << "," << bytesPerNode << "," << buildTime << "\n";
+        cout << " Done (" << bytesPerNode << " bytes/node)\n";
+    }
+    
+    out.close();
+    cout << "Node footprint benchmark saved to " << outputFile << "\n\n";
+}
+
+size_t walkHandles(const NodePtr& node) {
+    size_t count = 1;
+    for (const auto& child : node->getChildren()) {
+        count += walkHandles(child);
+    }
+    return count;
+}
+
+size_t walkRaw(FSNode* root) {
+    size_t count = 0;
+    vector<FSNode*> stack = {root};
+    while (!stack.empty()) {
+        FSNode* node = stack.back();
+        stack.pop_back();
+        count++;
+        node->appendChildren(stack);
+    }
+    return count;
+}
+
+void benchmarkTreeWalk(const string& outputFile, bool huge) {
+    vector<int> sizes = {100000, 1000000};
+    if (huge) {
+        sizes.push_back(10000000);
+    }
+    const int fanout = 100;
+    const int lookups = 1000000;
+    ofstream out(outputFile);
+    out << "nodes,walk_handles_ms,walk_raw_ms,lookup_ns\n";
+    
+    cout << "Benchmarking TREE WALK and lookups...\n";
+    
+    vector<string> entryNames;
+    for (int i = 0; i < fanout; i++) {
+        entryNames.push_back("entry_" + to_string(i));
+    }
+    mt19937 gen(42);
+    
+    for (int size : sizes) {
+        cout << "  Nodes: " << size << "..." << flush;
+        
+        InodeTable table;
+        auto root = table.create("", NodeType::DIRECTORY);
+        vector<FSNode*> frontier = {root.get()};
+        vector<FSNode*> parents;
+        int created = 1;
+        while (created < size) {
+            bool last = created + frontier.size() * fanout >= (size_t)size;
+            NodeType type = last ? NodeType::FILE : NodeType::DIRECTORY;
+            vector<FSNode*> next;
+            for (FSNode* dir : frontier) {
+                for (int i = 0; i < fanout && created < size; i++) {
+                    auto child = table.create(entryNames[i], type, dir);
+                    dir->addChild(child, true);
+                    next.push_back(child.get());
+                    created++;
+                }
+            }
+            parents.swap(frontier);
+            frontier.swap(next);
+        }
+        
+        auto startHandles = high_resolution_clock::now();
+        size_t handleCount = walkHandles(root);
+        auto endHandles = high_resolution_clock::now();
+        
+        auto startRaw = high_resolution_clock::now();
+        size_t rawCount = walkRaw(root.get());
+        auto endRaw = high_resolution_clock::now();
+        
+        uniform_int_distribution<size_t> pickDir(0, parents.size() - 1);
+        uniform_int_distribution<int> pickName(0, fanout - 1);
+        vector<pair<FSNode*, int>> queries;
+        for (int i = 0; i < lookups; i++) {
+            queries.push_back({parents[pickDir(gen)], pickName(gen)});
+        }
+        size_t found = 0;
+        auto startLookup = high_resolution_clock::now();
+        for (const auto& query : queries) {
+            found += query.first->findChild(entryNames[query.second]) != nullptr;
+        }
+        auto endLookup = high_resolution_clock::now();
+        
+        double handlesTime = duration_cast<microseconds>(endHandles - startHandles).count() / 1000.0;
+        double rawTime = duration_cast<microseconds>(endRaw - startRaw).count() / 1000.0;
+        double lookupTime = duration_cast<nanoseconds>(endLookup - startLookup).count() / (double)lookups;
+        root = nullptr;
+        
+        out << created << "," << handlesTime << "," << rawTime << "," << lookupTime << "\n";
+        cout << " Done (" << handlesTime << " / " << rawTime << " ms walk, " << lookupTime << " ns/lookup"
+             << (handleCount != rawCount || found == 0 ? ", mismatch" : "") << ")\n";
+    }
+    
+    out.close();
+    cout << "Tree walk benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkPathCache(const string& outputFile) {
+    vector<int> depths = {4, 16, 64};
+    const int filesPerDepth = 2048;
+    const int operations = 200000;
+    ofstream out(outputFile);
+    out << "depth,read_off_ns,read_on_ns,write_off_ns,write_on_ns,hit_rate\n";
+    
+    cout << "Benchmarking PATH CACHE (repeated deep paths)...\n";
+    
+    mt19937 gen(42);
+    for (int depth : depths) {
+        cout << "  Depth: " << depth << "..." << flush;
+        
+        double times[2][2];
+        double hitRate = 0;
+        for (int cached = 0; cached < 2; cached++) {
+            cout.setstate(ios::failbit);
+            FileSystem fs;
+            fs.setPathCacheEnabled(cached == 1);
+            string dir;
+            for (int i = 0; i < depth; i++) {
+                dir += "/level_" + to_string(i);
+                fs.createDirectory(dir, true);
+            }
+            vector<string> files;
+            for (int i = 0; i < filesPerDepth; i++) {
+                files.push_back(dir + "/file_" + to_string(i) + ".txt");
+                fs.createFile(files.back(), "x", true);
+            }
+            cout.clear();
+            
+            uniform_int_distribution<int> pick(0, filesPerDepth - 1);
+            vector<int> order;
+            for (int i = 0; i < operations; i++) {
+                order.push_back(pick(gen));
+            }
+            
+            size_t bytes = 0;
+            auto startRead = high_resolution_clock::now();
+            for (int idx : order) {
+                bytes += fs.readFile(files[idx]).size();
+            }
+            auto endRead = high_resolution_clock::now();
+            
+            auto startWrite = high_resolution_clock::now();
+            for (int idx : order) {
+                fs.writeFile(files[idx], "y");
+            }
+            auto endWrite = high_resolution_clock::now();
+            
+            times[cached][0] = duration_cast<nanoseconds>(endRead - startRead).count() / (double)operations;
+            times[cached][1] = duration_cast<nanoseconds>(endWrite - startWrite).count() / (double)operations;
+            if (cached) {
+                hitRate = fs.pathCacheStats().hitRate();
+            }
+            if (bytes != (size_t)operations) {
+                cout << " missing";
+            }
+        }
+        
+        out << depth << "," << times[0][0] << "," << times[1][0] << ","
+            << times[0][1] << "," << times[1][1] << "," << hitRate << "\n";
+        cout << " Done (read " << times[0][0] << " -> " << times[1][0] << " ns)\n";
+    }
+    
+    out.close();
+    cout << "Path cache benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkConcurrency(const string& outputFile) {
+#ifdef FS_CONCURRENT
+    vector<int> threadCounts = {1, 2, 4, 8, 16, 32};
+#else
+    vector<int> threadCounts = {1};
+#endif
+    const int dirs = 64;
+    const int filesPerDir = 64;
+    const int totalOperations = 400000;
+    ofstream out(outputFile);
+    out << "threads,ops_per_sec,speedup\n";
+    
+    cout << "Benchmarking CONCURRENCY (80% lookup, 10% create, 10% append)...\n";
+#ifndef FS_CONCURRENT
+    cout << "  (single-threaded build, use 'make CONCURRENT=1' for scaling)\n";
+#endif
+    
+    double baseline = 0;
+    for (int threads : threadCounts) {
+        cout << "  Threads: " << threads << "..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        vector<string> files;
+        for (int d = 0; d < dirs; d++) {
+            string dir = "/dir_" + to_string(d);
+            fs.createDirectory(dir, true);
+            for (int f = 0; f < filesPerDir; f++) {
+                files.push_back(dir + "/file_" + to_string(f));
+                fs.createFile(files.back(), "data", true);
+            }
+        }
+        
+        int perThread = totalOperations / threads;
+        vector<thread> workers;
+        auto start = high_resolution_clock::now();
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&fs, &files, t, perThread] {
+                mt19937 gen(t + 1);
+                uniform_int_distribution<size_t> pick(0, files.size() - 1);
+                uniform_int_distribution<int> kind(0, 9);
+                for (int i = 0; i < perThread; i++) {
+                    int op = kind(gen);
+                    const string& path = files[pick(gen)];
+                    if (op < 8) {
+                        fs.readFile(path);
+                    } else if (op == 8) {
+                        fs.createFile(path + "_" + to_string(t) + "_" + to_string(i), "", true);
+                    } else {
+                        fs.appendFile(path, "x");
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto end = high_resolution_clock::now();
+        cout.clear();
+        
+        double seconds = duration_cast<nanoseconds>(end - start).count() / 1e9;
+        double opsPerSec = (double)perThread * threads / seconds;
+        if (baseline == 0) {
+            baseline = opsPerSec;
+        }
+        
+        out << threads << "," << opsPerSec << "," << opsPerSec / baseline << "\n";
+        cout << " Done (" << (size_t)opsPerSec << " ops/s)\n";
+    }
+    
+    out.close();
+    cout << "Concurrency benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkConcurrentLookups(const string& outputFile) {
+#ifdef FS_CONCURRENT
+    vector<int> threadCounts = {1, 2, 4, 8, 16, 32};
+#else
+    vector<int> threadCounts = {1};
+#endif
+    const int dirs = 16;
+    const int filesPerDir = 256;
+    const int totalLookups = 800000;
+    ofstream out(outputFile);
+    out << "readers,lookups_per_sec,speedup,writer_ops_per_sec\n";
+    
+    cout << "Benchmarking CONCURRENT LOOKUPS (readers + 1 churning writer)...\n";
+    
+    double baseline = 0;
+    for (int readers : threadCounts) {
+        cout << "  Readers: " << readers << "..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        vector<string> files;
+        for (int d = 0; d < dirs; d++) {
+            string dir = "/dir_" + to_string(d);
+            fs.createDirectory(dir, true);
+            for (int f = 0; f < filesPerDir; f++) {
+                files.push_back(dir + "/file_" + to_string(f));
+                fs.createFile(files.back(), "data", true);
+            }
+        }
+        
+        atomic<bool> stop(false);
+        atomic<size_t> writerOps(0);
+        auto churn = [&fs, &stop, &writerOps] {
+            for (size_t i = 0; !stop; i++) {
+                string path = "/dir_" + to_string(i % dirs) + "/churn_" + to_string(i % 512);
+                if (!fs.createFile(path, "", true)) {
+                    fs.rm(path);
+                }
+                writerOps++;
+            }
+        };
+        
+        int perReader = totalLookups / readers;
+        vector<thread> workers;
+        auto start = high_resolution_clock::now();
+#ifdef FS_CONCURRENT
+        thread writer(churn);
+#endif
+        for (int t = 0; t < readers; t++) {
+            workers.emplace_back([&fs, &files, t, perReader] {
+                mt19937 gen(t + 1);
+                uniform_int_distribution<size_t> pick(0, files.size() - 1);
+                size_t bytes = 0;
+                for (int i = 0; i < perReader; i++) {
+                    bytes += fs.readFile(files[pick(gen)]).size();
+                }
+                if (bytes == 0) {
+                    cerr << "lookups failed\n";
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto end = high_resolution_clock::now();
+        stop = true;
+#ifdef FS_CONCURRENT
+        writer.join();
+#else
+        (void)churn;
+#endif
+        cout.clear();
+        
+        double seconds = duration_cast<nanoseconds>(end - start).count() / 1e9;
+        double lookupsPerSec = (double)perReader * readers / seconds;
+        if (baseline == 0) {
+            baseline = lookupsPerSec;
+        }
+        
+        out << readers << "," << lookupsPerSec << "," << lookupsPerSec / baseline << ","
+            << writerOps / seconds << "\n";
+        cout << " Done (" << (size_t)lookupsPerSec << " lookups/s)\n";
+    }
+    
+    out.close();
+    cout << "Concurrent lookup benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkTransactions(const string& outputFile) {
+    vector<int> bundleSizes = {1, 10, 100, 1000, 10000};
+    const int reads = 200000;
+    ofstream out(outputFile);
+    out << "bundle_files,commit_us,read_avg_ns,read_p99_ns\n";
+    
+    cout << "Benchmarking TRANSACTIONS (read latency during bundle commits)...\n";
+    
+    for (int bundle : bundleSizes) {
+        cout << "  Bundle: " << bundle << "..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        fs.createDirectory("/bundle", true);
+        vector<string> files;
+        for (int i = 0; i < bundle; i++) {
+            files.push_back("/bundle/conf_" + to_string(i));
+            fs.createFile(files.back(), "v0", true);
+        }
+        
+        atomic<bool> stop(false);
+        atomic<size_t> commits(0);
+        atomic<long long> commitNs(0);
+        auto commitLoop = [&fs, &files, &stop, &commits, &commitNs](int rounds) {
+            for (int round = 1; !stop && round <= rounds; round++) {
+                auto start = high_resolution_clock::now();
+                Transaction tx = fs.beginTransaction();
+                string value = "v" + to_string(round);
+                for (const auto& file : files) {
+                    tx.write(file, value);
+                }
+                tx.commit();
+                commitNs += duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+                commits++;
+            }
+        };
+        
+        vector<long long> latencies;
+        latencies.reserve(reads);
+        mt19937 gen(42);
+        uniform_int_distribution<size_t> pick(0, files.size() - 1);
+#ifdef FS_CONCURRENT
+        thread writer(commitLoop, INT32_MAX);
+        for (int i = 0; i < reads; i++) {
+#else
+        for (int i = 0; i < reads; i++) {
+            if (i % 1000 == 0) {
+                commitLoop(1);
+            }
+#endif
+            auto start = high_resolution_clock::now();
+            fs.readFile(files[pick(gen)]);
+            latencies.push_back(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count());
+        }
+        stop = true;
+#ifdef FS_CONCURRENT
+        writer.join();
+#endif
+        cout.clear();
+        
+        sort(latencies.begin(), latencies.end());
+        double average = 0;
+        for (long long latency : latencies) {
+            average += latency;
+        }
+        average /= latencies.size();
+        double commitUs = commits ? commitNs / 1000.0 / commits : 0;
+        
+        out << bundle << "," << commitUs << "," << average << ","
+            << latencies[latencies.size() * 99 / 100] << "\n";
+        cout << " Done (commit " << commitUs << " us, read p99 "
+             << latencies[latencies.size() * 99 / 100] << " ns)\n";
+    }
+    
+    out.close();
+    cout << "Transaction benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkSnapshots(const string& outputFile, bool huge) {
+    vector<int> sizes = {1000, 10000, 100000};
+    if (huge) {
+        sizes.push_back(1000000);
+    }
+    const int filesPerDir = 100;
+    ofstream out(outputFile);
+    out << "nodes,snapshot_us,write_ns,write_snap_ns,changed_files,preserved_nodes\n";
+    
+    cout << "Benchmarking SNAPSHOTS (creation time, copy-on-write overhead)...\n";
+    
+    for (int size : sizes) {
+        cout << "  Nodes: " << size << "..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        vector<string> files;
+        for (int i = 0; i < size; i++) {
+            if (i % filesPerDir == 0) {
+                fs.createDirectory("/d" + to_string(i / filesPerDir), true);
+            }
+            files.push_back("/d" + to_string(i / filesPerDir) + "/f" + to_string(i));
+            fs.createFile(files.back(), string(64, 'a'), true);
+        }
+        
+        int changed = max(1, size / 100);
+        auto timeWrites = [&fs, &files, changed](int offset) {
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < changed; i++) {
+                fs.appendFile(files[(offset + i * 97) % files.size()], "b");
+            }
+            return (double)duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / changed;
+        };
+        double writeNs = timeWrites(0);
+        
+        const int rounds = 20;
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            fs.snapshot("s" + to_string(i));
+        }
+        double snapshotUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / rounds;
+        for (int i = 1; i < rounds; i++) {
+            fs.deleteSnapshot("s" + to_string(i));
+        }
+        
+        double writeSnapNs = timeWrites(1);
+        size_t preserved = fs.snapshotPreservedNodes("s0");
+        cout.clear();
+        
+        out << size << "," << snapshotUs << "," << writeNs << "," << writeSnapNs << ","
+            << changed << "," << preserved << "\n";
+        cout << " Done (snapshot " << snapshotUs << " us, " << preserved
+             << " nodes preserved for " << changed << " changed files)\n";
+    }
+    
+    out.close();
+    cout << "Snapshot benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkCopy(const string& outputFile) {
+    vector<pair<int, int>> shapes = {{1000, 64}, {1000, 1024}, {1000, 8192}, {10000, 64}, {10000, 1024}};
+    const int filesPerDir = 100;
+    ofstream out(outputFile);
+    out << "files,file_bytes,cp_ms,manual_ms,first_write_us\n";
+    
+    cout << "Benchmarking COPY (cp -r with shared ropes vs readFile + writeFile)...\n";
+    
+    for (auto [files, bytes] : shapes) {
+        cout << "  Files: " << files << " x " << bytes << " bytes..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        fs.createDirectory("/src", true);
+        fs.createDirectory("/manual", true);
+        vector<string> names;
+        string content(bytes, 'x');
+        for (int i = 0; i < files; i++) {
+            string dir = "/d" + to_string(i / filesPerDir);
+            if (i % filesPerDir == 0) {
+                fs.createDirectory("/src" + dir, true);
+                fs.createDirectory("/manual" + dir, true);
+            }
+            names.push_back(dir + "/f" + to_string(i));
+            fs.createFile("/src" + names.back(), content, true);
+        }
+        
+        auto start = high_resolution_clock::now();
+        fs.cp("/src", "/copy", true);
+        double cpMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        
+        start = high_resolution_clock::now();
+        for (const auto& name : names) {
+            fs.writeFile("/manual" + name, fs.readFile("/src" + name));
+        }
+        double manualMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        
+        const int writes = 100;
+        start = high_resolution_clock::now();
+        for (int i = 0; i < writes; i++) {
+            fs.insertInFile("/copy" + names[i * 7 % names.size()], 0, "y");
+        }
+        double firstWriteUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / writes;
+        cout.clear();
+        
+        out << files << "," << bytes << "," << cpMs << "," << manualMs << "," << firstWriteUs << "\n";
+        cout << " Done (cp " << cpMs << " ms vs manual " << manualMs << " ms)\n";
+    }
+    
+    out.close();
+    cout << "Copy benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkRename(const string& outputFile) {
+    vector<int> sizes = {10, 1000, 100000};
+    const int filesPerDir = 100;
+    const int rounds = 1000;
+    ofstream out(outputFile);
+    out << "subtree_nodes,move_us,rename_us,emulated_ms\n";
+    
+    cout << "Benchmarking RENAME (relink vs cp -r + rm -r)...\n";
+    
+    for (int size : sizes) {
+        cout << "  Subtree: " << size << " nodes..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        fs.createDirectory("/left", true);
+        fs.createDirectory("/right", true);
+        fs.createDirectory("/left/tree", true);
+        for (int i = 0; i < size; i++) {
+            string dir = "/left/tree/d" + to_string(i / filesPerDir);
+            if (i % filesPerDir == 0) {
+                fs.createDirectory(dir, true);
+            }
+            fs.createFile(dir + "/f" + to_string(i), "content", true);
+        }
+        
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            fs.rename(i % 2 ? "/right/tree" : "/left/tree", i % 2 ? "/left/tree" : "/right/tree");
+        }
+        double moveUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / rounds;
+        
+        start = high_resolution_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            fs.rename(i % 2 ? "/left/renamed" : "/left/tree", i % 2 ? "/left/tree" : "/left/renamed");
+        }
+        double renameUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / rounds;
+        
+        start = high_resolution_clock::now();
+        fs.cp("/left/tree", "/right/tree", true);
+        fs.rm("/left/tree", true);
+        double emulatedMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        cout.clear();
+        
+        out << size << "," << moveUs << "," << renameUs << "," << emulatedMs << "\n";
+        cout << " Done (move " << moveUs << " us, rename " << renameUs
+             << " us, cp + rm " << emulatedMs << " ms)\n";
+    }
+    
+    out.close();
+    cout << "Rename benchmark saved to " << outputFile << "\n\n";
+}
+
+void benchmarkReclaim(const string& outputFile) {
+    vector<int> sizes = {1000, 100000, 1000000};
+    const int filesPerDir = 100;
+    const int creates = 2000;
+    ofstream out(outputFile);
+    out << "subtree_nodes,rm_us,max_create_us,reclaim_ms\n";
+    
+    cout << "Benchmarking RECLAIM (rm -r latency vs subtree size)...\n";
+    
+    for (int size : sizes) {
+        cout << "  Subtree: " << size << " nodes..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        fs.createDirectory("/work", true);
+        fs.createDirectory("/tree", true);
+        for (int i = 0; i < size; i++) {
+            string dir = "/tree/d" + to_string(i / filesPerDir);
+            if (i % filesPerDir == 0) {
+                fs.createDirectory(dir, true);
+            }
+            fs.createFile(dir + "/f" + to_string(i), "content", true);
+        }
+        
+        auto start = high_resolution_clock::now();
+        fs.rm("/tree", true);
+        double rmUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        
+        double maxCreateUs = 0;
+        for (int i = 0; i < creates; i++) {
+            auto opStart = high_resolution_clock::now();
+            fs.createFile("/work/f" + to_string(i), "", true);
+            double us = duration_cast<nanoseconds>(high_resolution_clock::now() - opStart).count() / 1000.0;
+            maxCreateUs = max(maxCreateUs, us);
+        }
+        
+        fs.waitForReclaim();
+        double reclaimMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        cout.clear();
+        
+        out << size << "," << rmUs << "," << maxCreateUs << "," << reclaimMs << "\n";
+        cout << " Done (rm " << rmUs << " us, slowest create " << maxCreateUs
+             << " us, reclaimed in " << reclaimMs << " ms)\n";
+    }
+    
+    out.close();
+    cout << "Reclaim benchmark saved to " << outputFile << "\n\n";
+}
+
+int64_t sumBytes(FSNode* root) {
+    int64_t bytes = 0;
+    vector<FSNode*> stack = {root};
+    while (!stack.empty()) {
+        FSNode* node = stack.back();
+        stack.pop_back();
+        if (node->isFile()) {
+            bytes += node->content().length();
+        }
+        node->appendChildren(stack);
+    }
+    return bytes;
+}
+
+void benchmarkDiskUsage(const string& outputFile) {
+    vector<int> sizes = {1000, 100000, 1000000};
+    const int filesPerDir = 100;
+    const int depth = 64;
+    const int rounds = 10000;
+    ofstream out(outputFile);
+    out << "files,du_us,walk_ms,append_shallow_us,append_deep_us\n";
+    
+    cout << "Benchmarking DISK USAGE (aggregates vs full walk)...\n";
+    
+    for (int size : sizes) {
+        cout << "  Files: " << size << "..." << flush;
+        
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        fs.createDirectory("/tree", true);
+        for (int i = 0; i < size; i++) {
+            string dir = "/tree/d" + to_string(i / filesPerDir);
+            if (i % filesPerDir == 0) {
+                fs.createDirectory(dir, true);
+            }
+            fs.createFile(dir + "/f" + to_string(i), "content", true);
+        }
+        string deep = "/tree";
+        for (int level = 0; level < depth; level++) {
+            deep += "/n";
+            fs.createDirectory(deep, true);
+        }
+        fs.createFile(deep + "/log", "", true);
+        fs.createFile("/tree/log", "", true);
+        
+        int64_t reported = 0;
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            reported = fs.usage("/tree").bytes;
+        }
+        double duUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / rounds;
+        
+        FSNode* tree = fs.openDir("/tree").dir.get();
+        start = high_resolution_clock::now();
+        int64_t walked = sumBytes(tree);
+        double walkMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        
+        start = high_resolution_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            fs.appendFile("/tree/log", "x");
+        }
+        double shallowUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / rounds;
+        
+        string deepLog = deep + "/log";
+        start = high_resolution_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            fs.appendFile(deepLog, "x");
+        }
+        double deepUs = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1000.0 / rounds;
+        cout.clear();
+        
+        out << size << "," << duUs << "," << walkMs << "," << shallowUs << "," << deepUs << "\n";
+        cout << " Done (du " << duUs << " us, walk " << walkMs << " ms, append at depth 1/"
+             << depth + 1 << ": " << shallowUs << "/" << deepUs << " us"
+             << (reported != walked ? ", mismatch" : "") << ")\n";
+    }
+    
+    out.close();
+    cout << "Disk usage benchmark saved to " << outputFile << "\n\n";
+}
+
+void eagerSearch(const NodePtr& node, const string& name, const string& path, vector<string>& results) {
+    for (const auto& child : node->getChildren()) {
+        string childPath = path + "/" + string(child->name);
+        if (child->name.find(name) != string_view::npos) {
+            results.push_back(childPath);
+        }
+        if (child->isDirectory()) {
+            eagerSearch(child, name, childPath, results);
+        }
+    }
+}
+
+void benchmarkParallelSearch(const string& outputFile, bool huge) {
+    vector<int> sizes = {1000000};
+    if (huge) {
+        sizes.push_back(10000000);
+    }
+    vector<size_t> threadCounts = {1, 2, 4, 8};
+    const int filesPerDir = 100;
+    const int dirsPerGroup = 100;
+    const string pattern = "f777";
+    ofstream out(outputFile);
+    out << "nodes,threads,search_ms,eager_ms,matches\n";
+    
+    cout << "Benchmarking PARALLEL SEARCH (work-stealing walk vs eager recursion)...\n";
+    
+    for (int size : sizes) {
+        cout.setstate(ios::failbit);
+        FileSystem fs;
+        fs.createDirectory("/tree", true);
+        for (int i = 0; i < size; i++) {
+            string group = "/tree/g" + to_string(i / (filesPerDir * dirsPerGroup));
+            string dir = group + "/d" + to_string(i / filesPerDir);
+            if (i % (filesPerDir * dirsPerGroup) == 0) {
+                fs.createDirectory(group, true);
+            }
+            if (i % filesPerDir == 0) {
+                fs.createDirectory(dir, true);
+            }
+            fs.createFile(dir + "/f" + to_string(i), "", true);
+        }
+        
+        vector<string> eager;
+        auto start = high_resolution_clock::now();
+        eagerSearch(fs.openDir("/").dir, pattern, "", eager);
+        double eagerMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+        cout.clear();
+        
+        for (size_t threads : threadCounts) {
+            cout << "  Nodes: " << size << ", threads: " << threads << "..." << flush;
+            cout.setstate(ios::failbit);
+            fs.setWalkThreads(threads);
+            start = high_resolution_clock::now();
+            auto found = fs.search(pattern);
+            double searchMs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+            cout.clear();
+            
+            out << size << "," << threads << "," << searchMs << "," << eagerMs << "," << found.size() << "\n";
+            cout << " Done (" << searchMs << " ms vs eager " << eagerMs << " ms, "
+                 << found.size() << " matches" << (found != eager ? ", mismatch" : "") << ")\n";
+        }
+    }
+    
+    out.close();
+    cout << "Parallel search benchmark saved to " << outputFile << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    bool huge = argc > 1 && string(argv[1]) == "--huge";
+
     srand(time(nullptr));
     
     cout << "=== AVL H-Tree Performance Benchmark ===\n\n";
@@ -239,6 +1498,25 @@ int main() {
     benchmarkInsert("benchmark_insert.csv");
     benchmarkFind("benchmark_find.csv");
     benchmarkRemove("benchmark_remove.csv");
+    benchmarkSmallDirectories("benchmark_small_dirs.csv");
+    benchmarkBulkLoad("benchmark_bulk.csv");
+    benchmarkNegativeLookups("benchmark_bloom.csv");
+    benchmarkLargeDirectories("benchmark_large.csv", huge);
+    benchmarkFindMany("benchmark_find_many.csv");
+    benchmarkNameStorage("benchmark_names.csv");
+    benchmarkDeepPaths("benchmark_deep_paths.csv");
+    benchmarkNodeFootprint("benchmark_node_size.csv", huge);
+    benchmarkTreeWalk("benchmark_tree_walk.csv", huge);
+    benchmarkPathCache("benchmark_path_cache.csv");
+    benchmarkConcurrency("benchmark_concurrency.csv");
+    benchmarkConcurrentLookups("benchmark_concurrent_lookup.csv");
+    benchmarkTransactions("benchmark_transactions.csv");
+    benchmarkSnapshots("benchmark_snapshots.csv", huge);
+    benchmarkCopy("benchmark_copy.csv");
+    benchmarkRename("benchmark_rename.csv");
+    benchmarkReclaim("benchmark_reclaim.csv");
+    benchmarkDiskUsage("benchmark_disk_usage.csv");
+    benchmarkParallelSearch("benchmark_parallel_search.csv", huge);
     
     cout << "All benchmarks completed!\n";
     cout << "Run 'python3 plot_benchmarks.py' to generate graphs.\n";
@@ -85,7 +85,7 @@ void runTerminal(FileSystem& fs) {
         else if (command == "help") {
             cout << "Доступные команды:" << endl;
             cout << "  pwd              - показать текущий путь" << endl;
-            cout << "  ls [-l]          - список файлов" << endl;
+            cout << "  ls [-l] [p*]     - список файлов по имени (p* - по префиксу)" << endl;
             cout << "  cd <path>        - перейти в директорию" << endl;
             cout << "  mkdir <name>     - создать директорию" << endl;
             cout << "  touch <name>     - создать пустой файл" << endl;
@@ -93,9 +93,15 @@ void runTerminal(FileSystem& fs) {
             cout << "  echo <text>      - вывести текст (можно с > file или >> file)" << endl;
             cout << "  rm <name>        - удалить файл" << endl;
             cout << "  rm -r <name>     - удалить директорию рекурсивно" << endl;
+            cout << "  cp [-r] <src> <dst> - копировать файл или каталог" << endl;
+            cout << "  mv <src> <dst>   - переместить или переименовать" << endl;
             cout << "  chmod <mode> <f> - изменить права (например: chmod 755 file)" << endl;
+            cout << "  du [-s] [path]   - объём каталога (-s - только итог)" << endl;
             cout << "  find <pattern>   - найти файлы по шаблону" << endl;
             cout << "  tree             - показать дерево файловой системы" << endl;
+            cout << "  freeze <path>    - уплотнить каталоги только для чтения" << endl;
+            cout << "  cache [on|off]   - статистика или переключение кэша путей" << endl;
+            cout << "  snapshot [-d] <n> - создать (или удалить) снимок /.snapshots/<n>" << endl;
             cout << "  clear            - очистить экран" << endl;
             cout << "  debug            - переключить режим отладки" << endl;
             cout << "  ed <f> <op> [...] - редактор (insert/delete/append/find)" << endl;
@@ -183,6 +189,22 @@ void runTerminal(FileSystem& fs) {
                 fs.rm(cmd.args[1], false);
             }
         }
+        else if (command == "cp") {
+            bool recursive = cmd.args.size() >= 2 && cmd.args[1] == "-r";
+            size_t first = recursive ? 2 : 1;
+            if (cmd.args.size() < first + 2) {
+                cout << "cp: отсутствует операнд" << endl;
+            } else {
+                fs.cp(cmd.args[first], cmd.args[first + 1], recursive);
+            }
+        }
+        else if (command == "mv") {
+            if (cmd.args.size() < 3) {
+                cout << "mv: отсутствует операнд" << endl;
+            } else {
+                fs.mv(cmd.args[1], cmd.args[2]);
+            }
+        }
         else if (command == "chmod") {
             if (cmd.args.size() < 3) {
                 cout << "chmod: отсутствует операнд" << endl;
@@ -190,6 +212,20 @@ void runTerminal(FileSystem& fs) {
                 fs.chmod(cmd.args[1], cmd.args[2]);
             }
         }
+        else if (command == "du") {
+            bool summarize = false;
+            string path = ".";
+            
+            for (size_t i = 1; i < cmd.args.size(); i++) {
+                if (cmd.args[i] == "-s") {
+                    summarize = true;
+                } else {
+                    path = cmd.args[i];
+                }
+            }
+            
+            fs.du(path, summarize);
+        }
         else if (command == "find") {
             if (cmd.args.size() < 2) {
                 cout << "find: отсутствует операнд" << endl;
@@ -200,6 +236,26 @@ void runTerminal(FileSystem& fs) {
         else if (command == "tree") {
             fs.visualize();
         }
+        else if (command == "freeze") {
+            fs.freeze(cmd.args.size() < 2 ? "." : cmd.args[1]);
+        }
+        else if (command == "snapshot") {
+            if (cmd.args.size() >= 3 && cmd.args[1] == "-d") {
+                fs.deleteSnapshot(cmd.args[2]);
+            } else if (cmd.args.size() >= 2) {
+                fs.snapshot(cmd.args[1]);
+            } else {
+                for (const auto& name : fs.listSnapshots()) {
+                    cout << name << endl;
+                }
+            }
+        }
+        else if (command == "cache") {
+            if (cmd.args.size() >= 2 && (cmd.args[1] == "on" || cmd.args[1] == "off")) {
+                fs.setPathCacheEnabled(cmd.args[1] == "on");
+            }
+            fs.printPathCacheStats();
+        }
         else if (command == "clear") {
             cout << "\033[2J\033[1;1H";
         }
@@ -67,6 +67,64 @@ def plot_combined():
     print("Saved: benchmark_combined.png")
     plt.close()
 
+def plot_small_dirs():
+    df = pd.read_csv('benchmark_small_dirs.csv')
+    
+    fig, axes = plt.subplots(1, 2, figsize=(14, 5))
+    
+    axes[0].plot(df['fanout'], df['inline_bytes'], marker='o', linewidth=2, label='Inline array', color='green')
+    axes[0].plot(df['fanout'], df['tree_bytes'], marker='s', linewidth=2, label='AVL tree', color='blue')
+    axes[0].set_xlabel('Entries per Directory', fontsize=11, fontweight='bold')
+    axes[0].set_ylabel('Bytes per Directory', fontsize=11, fontweight='bold')
+    axes[0].set_title('Index Memory', fontsize=12, fontweight='bold')
+    axes[0].legend(loc='best', fontsize=10)
+    axes[0].grid(True, alpha=0.3)
+    
+    axes[1].plot(df['fanout'], df['inline_find'], marker='o', linewidth=2, label='Inline array', color='green')
+    axes[1].plot(df['fanout'], df['tree_find'], marker='s', linewidth=2, label='AVL tree', color='blue')
+    axes[1].set_xlabel('Entries per Directory', fontsize=11, fontweight='bold')
+    axes[1].set_ylabel('Time per Lookup (ns)', fontsize=11, fontweight='bold')
+    axes[1].set_title('Lookup Latency', fontsize=12, fontweight='bold')
+    axes[1].legend(loc='best', fontsize=10)
+    axes[1].grid(True, alpha=0.3)
+    
+    plt.suptitle('Small Directories: Inline vs AVL H-Tree', fontsize=14, fontweight='bold', y=1.02)
+    plt.tight_layout()
+    plt.savefig('benchmark_small_dirs.png', dpi=300, bbox_inches='tight')
+    print("Saved: benchmark_small_dirs.png")
+    plt.close()
+
+def plot_large_dirs():
+    df = pd.read_csv('benchmark_large.csv')
+    
+    fig, axes = plt.subplots(1, 2, figsize=(14, 5))
+    
+    axes[0].plot(df['size'], df['avl_find'], marker='s', linewidth=2, label='AVL H-Tree', color='blue')
+    axes[0].plot(df['size'], df['btree_find'], marker='o', linewidth=2, label='B+ Tree', color='green')
+    axes[0].plot(df['size'], df['frozen_find'], marker='^', linewidth=2, label='Frozen (Eytzinger)', color='purple')
+    axes[0].set_xscale('log')
+    axes[0].set_xlabel('Number of Elements', fontsize=11, fontweight='bold')
+    axes[0].set_ylabel('Time per Lookup (ns)', fontsize=11, fontweight='bold')
+    axes[0].set_title('Random Lookup Latency', fontsize=12, fontweight='bold')
+    axes[0].legend(loc='best', fontsize=10)
+    axes[0].grid(True, alpha=0.3)
+    
+    axes[1].plot(df['size'], df['avl_bytes'], marker='s', linewidth=2, label='AVL H-Tree', color='blue')
+    axes[1].plot(df['size'], df['btree_bytes'], marker='o', linewidth=2, label='B+ Tree', color='green')
+    axes[1].plot(df['size'], df['frozen_bytes'], marker='^', linewidth=2, label='Frozen (Eytzinger)', color='purple')
+    axes[1].set_xscale('log')
+    axes[1].set_xlabel('Number of Elements', fontsize=11, fontweight='bold')
+    axes[1].set_ylabel('Index Bytes per Entry', fontsize=11, fontweight='bold')
+    axes[1].set_title('Index Memory', fontsize=12, fontweight='bold')
+    axes[1].legend(loc='best', fontsize=10)
+    axes[1].grid(True, alpha=0.3)
+    
+    plt.suptitle('Large Directories: AVL H-Tree vs B+ Tree vs Frozen', fontsize=14, fontweight='bold', y=1.02)
+    plt.tight_layout()
+    plt.savefig('benchmark_large.png', dpi=300, bbox_inches='tight')
+    print("Saved: benchmark_large.png")
+    plt.close()
+
 def generate_statistics():
     with open('benchmark_statistics.txt', 'w') as f:
         f.write("=== AVL H-Tree Performance Statistics ===\n\n")
@@ -82,6 +140,140 @@ def generate_statistics():
             f.write(f"  Worst case:   {df['worst'].min():.2f} - {df['worst'].max():.2f} ns\n")
             f.write(f"  Worst/Best ratio at max size: {df['worst'].iloc[-1] / df['best'].iloc[-1]:.2f}x\n")
             f.write("\n")
+        
+        df = pd.read_csv('benchmark_bulk.csv')
+        f.write("BULK LOAD (ms, repeated insert vs bulkLoad):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['size']):7d} entries: build {row['insert']:8.2f} vs {row['bulk_load']:8.2f}, "
+                    f"merge half {row['merge_insert']:8.2f} vs {row['bulk_merge']:8.2f}\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_bloom.csv')
+        f.write("NEGATIVE LOOKUPS (ns, no filter vs Bloom filter):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['size']):7d} entries: {row['plain']:7.1f} vs {row['filtered']:7.1f} ns, "
+                    f"{row['filter_bytes_per_entry']:.2f} bytes/entry, FPR {row['false_positive_rate'] * 100:.2f}%\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_large.csv')
+        f.write("LARGE DIRECTORIES (AVL vs B+ tree vs frozen):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['size']):9d} entries: {row['avl_find']:7.1f} vs {row['btree_find']:7.1f} "
+                    f"vs {row['frozen_find']:7.1f} ns/lookup, "
+                    f"{row['avl_bytes']:6.1f} vs {row['btree_bytes']:6.1f} vs {row['frozen_bytes']:6.1f} bytes/entry\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_find_many.csv')
+        f.write("BATCHED FIND (ns/lookup, find vs findMany):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['size']):9d} entries: {row['find']:7.1f} vs {row['find_many']:7.1f}\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_names.csv')
+        f.write("NAME STORAGE (FileSystem with 1000 dirs x 100 files):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {row['workload']:>12s}: {row['bytes_per_entry']:7.1f} bytes/entry, build {row['build_ms']:8.1f} ms\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_deep_paths.csv')
+        f.write("DEEP PATHS (ns, readFile lookup / createFile+remove / writeFile+rm / cd ..+cd back / ../../ path):\n")
+        for _, row in df.iterrows():
+            f.write(f"  depth {int(row['depth']):3d}: {row['lookup_ns']:9.1f} / {row['create_remove_ns']:9.1f} "
+                    f"/ {row['write_rm_ns']:9.1f} / {row['cd_parent_ns']:9.1f} / {row['relative_ns']:9.1f}\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_node_size.csv')
+        f.write("NODE FOOTPRINT (directories of 1000 files):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['nodes']):9d} nodes: sizeof(FSNode) {int(row['sizeof_node'])}, "
+                    f"{row['bytes_per_node']:7.1f} bytes/node, build {row['build_ms']:8.0f} ms\n")
+        f.write("\n")
+
+        df = pd.read_csv('benchmark_tree_walk.csv')
+        f.write("TREE WALK (ms, handles vs raw inode pointers) AND LOOKUPS:\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['nodes']):9d} nodes: {row['walk_handles_ms']:8.2f} vs {row['walk_raw_ms']:8.2f} ms, "
+                    f"{row['lookup_ns']:7.1f} ns/lookup\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_path_cache.csv')
+        f.write("PATH CACHE (ns, readFile / writeFile on repeated deep paths, cache off vs on):\n")
+        for _, row in df.iterrows():
+            f.write(f"  depth {int(row['depth']):3d}: {row['read_off_ns']:8.1f} vs {row['read_on_ns']:8.1f}, "
+                    f"{row['write_off_ns']:8.1f} vs {row['write_on_ns']:8.1f}, hit rate {row['hit_rate'] * 100:.1f}%\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_concurrency.csv')
+        f.write("CONCURRENCY (mixed lookup/create/append throughput):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['threads']):2d} threads: {row['ops_per_sec']:12.0f} ops/s, "
+                    f"speedup {row['speedup']:5.2f}x\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_concurrent_lookup.csv')
+        f.write("CONCURRENT LOOKUPS (lock-free readers while one writer churns):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['readers']):2d} readers: {row['lookups_per_sec']:12.0f} lookups/s, "
+                    f"speedup {row['speedup']:5.2f}x, writer {row['writer_ops_per_sec']:10.0f} ops/s\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_transactions.csv')
+        f.write("TRANSACTIONS (bundle commit time, readFile latency while commits run):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['bundle_files']):6d} files: commit {row['commit_us']:10.1f} us, "
+                    f"read avg {row['read_avg_ns']:8.1f} ns, p99 {row['read_p99_ns']:8.1f} ns\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_snapshots.csv')
+        f.write("SNAPSHOTS (creation time, appendFile before vs after a snapshot, preserved nodes):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['nodes']):8d} nodes: snapshot {row['snapshot_us']:8.1f} us, "
+                    f"write {row['write_ns']:8.1f} vs {row['write_snap_ns']:8.1f} ns, "
+                    f"{int(row['preserved_nodes'])} preserved for {int(row['changed_files'])} changed files\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_copy.csv')
+        f.write("COPY (ms, cp -r sharing ropes vs readFile + writeFile per file):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['files']):6d} files x {int(row['file_bytes']):5d} bytes: "
+                    f"{row['cp_ms']:9.2f} vs {row['manual_ms']:9.2f} ms, "
+                    f"first write to a copy {row['first_write_us']:7.1f} us\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_rename.csv')
+        f.write("RENAME (us per move between dirs / rename in place, ms for cp -r + rm -r):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['subtree_nodes']):7d} nodes: move {row['move_us']:7.2f} us, "
+                    f"rename {row['rename_us']:7.2f} us, cp + rm {row['emulated_ms']:9.2f} ms\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_reclaim.csv')
+        f.write("RECLAIM (rm -r latency, slowest create while reclaiming, total reclaim time):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['subtree_nodes']):7d} nodes: rm {row['rm_us']:7.2f} us, "
+                    f"create max {row['max_create_us']:7.1f} us, reclaimed in {row['reclaim_ms']:9.2f} ms\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_disk_usage.csv')
+        f.write("DISK USAGE (du from aggregates vs full walk, append cost at depth 1 / 65):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['files']):7d} files: du {row['du_us']:6.2f} us vs walk {row['walk_ms']:9.2f} ms, "
+                    f"append {row['append_shallow_us']:6.2f} / {row['append_deep_us']:6.2f} us\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_parallel_search.csv')
+        f.write("PARALLEL SEARCH (ms, work-stealing walk with lazy paths vs eager recursion):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['nodes']):8d} nodes, {int(row['threads'])} threads: "
+                    f"{row['search_ms']:9.2f} vs {row['eager_ms']:9.2f} ms, {int(row['matches'])} matches\n")
+        f.write("\n")
+        
+        df = pd.read_csv('benchmark_small_dirs.csv')
+        f.write("SMALL DIRECTORIES (inline vs AVL):\n")
+        for _, row in df.iterrows():
+            f.write(f"  {int(row['fanout']):3d} entries: {row['inline_bytes']:8.1f} vs {row['tree_bytes']:8.1f} bytes/dir, "
+                    f"{row['inline_find']:6.1f} vs {row['tree_find']:6.1f} ns/lookup\n")
+        f.write("\n")
     
     print("Saved: benchmark_statistics.txt")
 
@@ -89,5 +281,7 @@ if __name__ == '__main__':
     print("Generating performance graphs...")
     plot_all_operations()
     plot_combined()
+    plot_small_dirs()
+    plot_large_dirs()
     generate_statistics()
     print("\nAll graphs generated successfully!")
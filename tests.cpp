@@ -2,7 +2,13 @@
 #include "Rope.h"
 #include "AVLHTree.h"
 #include "FileSystem.h"
+#include "LookupTable.h"
 #include <sstream>
+#include <set>
+#include <random>
+#include <thread>
+#include <functional>
+#include <algorithm>
 
 class RopeTest : public ::testing::Test {
 protected:
@@ -124,17 +130,33 @@ TEST_F(RopeTest, MultipleDeletes) {
     EXPECT_EQ(r.toString(), "ABDEGH");
 }
 
+TEST_F(RopeTest, CopiesShareNodesUntilWritten) {
+    Rope r1("The quick brown fox jumps over the lazy dog");
+    Rope r2 = r1;
+    EXPECT_TRUE(r2.sharesWith(r1));
+
+    testing::internal::CaptureStdout();
+    r2.insert(4, "very ");
+    r2.deleteSubstring("lazy ");
+    testing::internal::GetCapturedStdout();
+    r1.append("!");
+
+    EXPECT_FALSE(r2.sharesWith(r1));
+    EXPECT_EQ(r1.toString(), "The quick brown fox jumps over the lazy dog!");
+    EXPECT_EQ(r2.toString(), "The very quick brown fox jumps over the dog");
+}
+
 class AVLHTreeTest : public ::testing::Test {
 protected:
     HTreeIndex htree;
-    shared_ptr<FSNode> node1;
-    shared_ptr<FSNode> node2;
-    shared_ptr<FSNode> node3;
+    NodePtr node1;
+    NodePtr node2;
+    NodePtr node3;
 
     void SetUp() override {
-        node1 = make_shared<FSNode>("file1.txt", NodeType::FILE);
-        node2 = make_shared<FSNode>("file2.txt", NodeType::FILE);
-        node3 = make_shared<FSNode>("dir1", NodeType::DIRECTORY);
+        node1 = FSNode::create("file1.txt", NodeType::FILE);
+        node2 = FSNode::create("file2.txt", NodeType::FILE);
+        node3 = FSNode::create("dir1", NodeType::DIRECTORY);
     }
 };
 
@@ -194,7 +216,7 @@ TEST_F(AVLHTreeTest, GetAllNodes) {
 TEST_F(AVLHTreeTest, HashCollisionHandling) {
     for (int i = 0; i < 100; i++) {
         std::string name = "file" + std::to_string(i) + ".txt";
-        auto node = make_shared<FSNode>(name, NodeType::FILE);
+        auto node = FSNode::create(name, NodeType::FILE);
         htree.insert(name, node);
     }
     EXPECT_EQ(htree.size(), 100);
@@ -208,20 +230,545 @@ TEST_F(AVLHTreeTest, HashCollisionHandling) {
 TEST_F(AVLHTreeTest, TreeBalance) {
     for (int i = 0; i < 1000; i++) {
         std::string name = "node" + std::to_string(i);
-        auto node = make_shared<FSNode>(name, NodeType::FILE);
+        auto node = FSNode::create(name, NodeType::FILE);
         htree.insert(name, node);
     }
     EXPECT_EQ(htree.size(), 1000);
 }
 
+TEST_F(AVLHTreeTest, LowerBoundOrderedByName) {
+    htree.insert("file2.txt", node2);
+    htree.insert("dir1", node3);
+    htree.insert("file1.txt", node1);
+    auto nodes = htree.lowerBound("");
+    ASSERT_EQ(nodes.size(), 3);
+    EXPECT_EQ(nodes[0]->name, "dir1");
+    EXPECT_EQ(nodes[1]->name, "file1.txt");
+    EXPECT_EQ(nodes[2]->name, "file2.txt");
+
+    auto page = htree.lowerBound("e", 1);
+    ASSERT_EQ(page.size(), 1);
+    EXPECT_EQ(page[0]->name, "file1.txt");
+}
+
+TEST_F(AVLHTreeTest, PrefixRange) {
+    for (int i = 0; i < 50; i++) {
+        std::string name = (i % 2 ? "log" : "img") + std::to_string(i);
+        htree.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    auto logs = htree.prefixRange("log");
+    EXPECT_EQ(logs.size(), 25);
+    for (size_t i = 1; i < logs.size(); i++) {
+        EXPECT_LT(logs[i - 1]->name, logs[i]->name);
+    }
+    EXPECT_TRUE(htree.prefixRange("tmp").empty());
+}
+
+TEST_F(AVLHTreeTest, NameOrderTracksUpdates) {
+    htree.insert("file1.txt", node1);
+    EXPECT_EQ(htree.lowerBound("").size(), 1);
+    htree.insert("file2.txt", node2);
+    htree.remove("file1.txt");
+    auto nodes = htree.lowerBound("");
+    ASSERT_EQ(nodes.size(), 1);
+    EXPECT_EQ(nodes[0]->name, "file2.txt");
+}
+
+TEST_F(AVLHTreeTest, NameOrderFollowsLargeDirectory) {
+    for (int i = 0; i < 100; i++) {
+        std::string name = "n" + std::to_string(i);
+        htree.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    EXPECT_EQ(htree.lowerBound("n5", 1)[0]->name, "n5");
+    htree.insert("n50a", FSNode::create("n50a", NodeType::FILE));
+    htree.remove("n50");
+    auto page = htree.lowerBound("n5", 3);
+    ASSERT_EQ(page.size(), 3);
+    EXPECT_EQ(page[0]->name, "n5");
+    EXPECT_EQ(page[1]->name, "n50a");
+    EXPECT_EQ(page[2]->name, "n51");
+    EXPECT_EQ(htree.nameOrderSize(), 100u);
+    EXPECT_EQ(htree.lowerBound("").size(), 100u);
+}
+
+TEST_F(AVLHTreeTest, SmallDirectoryStaysInline) {
+    EXPECT_TRUE(htree.isInline());
+    for (size_t i = 0; i < HTreeIndex::INLINE_LIMIT; i++) {
+        std::string name = "f" + std::to_string(i);
+        htree.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    EXPECT_TRUE(htree.isInline());
+    EXPECT_EQ(htree.size(), HTreeIndex::INLINE_LIMIT);
+    for (size_t i = 0; i < HTreeIndex::INLINE_LIMIT; i++) {
+        EXPECT_NE(htree.find("f" + std::to_string(i)), nullptr);
+    }
+    EXPECT_EQ(htree.find("missing"), nullptr);
+}
+
+TEST_F(AVLHTreeTest, PromoteAndDemote) {
+    for (int i = 0; i < 40; i++) {
+        std::string name = "f" + std::to_string(i);
+        htree.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    EXPECT_FALSE(htree.isInline());
+    for (int i = 0; i < 37; i++) {
+        EXPECT_TRUE(htree.remove("f" + std::to_string(i)));
+    }
+    EXPECT_TRUE(htree.isInline());
+    EXPECT_EQ(htree.size(), 3);
+    EXPECT_EQ(htree.getAllNodes().size(), 3);
+    for (int i = 37; i < 40; i++) {
+        EXPECT_NE(htree.find("f" + std::to_string(i)), nullptr);
+    }
+}
+
+TEST_F(AVLHTreeTest, InlineAndTreeAgree) {
+    HTreeIndex treeOnly(0);
+    for (int i = 0; i < 6; i++) {
+        std::string name = "entry" + std::to_string(i);
+        auto node = FSNode::create(name, NodeType::FILE);
+        htree.insert(name, node);
+        treeOnly.insert(name, node);
+    }
+    EXPECT_TRUE(htree.isInline());
+    EXPECT_FALSE(treeOnly.isInline());
+
+    auto a = htree.getAllNodes();
+    auto b = treeOnly.getAllNodes();
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        EXPECT_EQ(a[i], b[i]);
+    }
+    auto afterA = htree.entriesAfter(HashFunction::hash(a[1]->name), a[1]->name, 10);
+    auto afterB = treeOnly.entriesAfter(HashFunction::hash(b[1]->name), b[1]->name, 10);
+    EXPECT_EQ(afterA.size(), 4);
+    EXPECT_EQ(afterA, afterB);
+}
+
+TEST_F(AVLHTreeTest, BulkLoadBuildsSearchableTree) {
+    vector<NodePtr> items;
+    for (int i = 0; i < 1000; i++) {
+        items.push_back(FSNode::create("bulk" + std::to_string(i), NodeType::FILE));
+    }
+    htree.bulkLoad(items);
+    EXPECT_EQ(htree.size(), 1000);
+    EXPECT_FALSE(htree.isInline());
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_NE(htree.find("bulk" + std::to_string(i)), nullptr);
+    }
+    EXPECT_TRUE(htree.remove("bulk500"));
+    EXPECT_EQ(htree.find("bulk500"), nullptr);
+}
+
+TEST_F(AVLHTreeTest, BulkLoadMergesIntoExistingIndex) {
+    HTreeIndex reference(0);
+    for (int i = 0; i < 300; i += 2) {
+        std::string name = "m" + std::to_string(i);
+        auto node = FSNode::create(name, NodeType::FILE);
+        htree.insert(name, node);
+        reference.insert(name, node);
+    }
+    vector<NodePtr> items;
+    for (int i = 1; i < 300; i += 2) {
+        std::string name = "m" + std::to_string(i);
+        auto node = FSNode::create(name, NodeType::FILE);
+        items.push_back(node);
+        reference.insert(name, node);
+    }
+    htree.bulkLoad(items);
+    EXPECT_EQ(htree.size(), 300);
+    EXPECT_EQ(htree.getAllNodes(), reference.getAllNodes());
+    EXPECT_EQ(htree.lowerBound("m150", 1)[0]->name, "m150");
+}
+
+TEST_F(AVLHTreeTest, BulkLoadSmallStaysInline) {
+    htree.insert("file1.txt", node1);
+    htree.bulkLoad({node2, node3});
+    EXPECT_TRUE(htree.isInline());
+    EXPECT_EQ(htree.size(), 3);
+    EXPECT_EQ(htree.find("dir1"), node3);
+}
+
+TEST_F(AVLHTreeTest, BulkLoadReplacesOverlappingNames) {
+    for (size_t btreeLimit : {HTreeIndex::BTREE_LIMIT, size_t(0)}) {
+        HTreeIndex index(HTreeIndex::INLINE_LIMIT, btreeLimit);
+        vector<NodePtr> first, second;
+        for (int i = 0; i < 100; i++) {
+            first.push_back(FSNode::create("n" + std::to_string(i), NodeType::FILE));
+        }
+        for (int i = 50; i < 150; i++) {
+            second.push_back(FSNode::create("n" + std::to_string(i), NodeType::FILE));
+        }
+        second.push_back(FSNode::create("n60", NodeType::DIRECTORY));
+        index.bulkLoad(first);
+        index.bulkLoad(second);
+
+        EXPECT_EQ(index.size(), 150);
+        EXPECT_EQ(index.getAllNodes().size(), 150u);
+        EXPECT_EQ(index.find("n10"), first[10]);
+        EXPECT_EQ(index.find("n70"), second[20]);
+        EXPECT_EQ(index.find("n60"), second.back());
+        EXPECT_EQ(first[70]->useCount(), 1u);
+        EXPECT_EQ(second[10]->useCount(), 1u);
+        EXPECT_TRUE(index.remove("n60"));
+        EXPECT_EQ(index.find("n60"), nullptr);
+        EXPECT_EQ(index.size(), 149);
+    }
+}
+
+TEST(BloomFilterTest, NoFalseNegatives) {
+    BloomFilter filter;
+    filter.reset(1000);
+    for (uint32_t i = 0; i < 1000; i++) {
+        filter.add(HashFunction::hash("name" + std::to_string(i)));
+    }
+    for (uint32_t i = 0; i < 1000; i++) {
+        EXPECT_TRUE(filter.mayContain(HashFunction::hash("name" + std::to_string(i))));
+    }
+    int falsePositives = 0;
+    for (uint32_t i = 0; i < 10000; i++) {
+        falsePositives += filter.mayContain(HashFunction::hash("absent" + std::to_string(i)));
+    }
+    EXPECT_LT(falsePositives, 200);
+}
+
+TEST(NameArenaTest, InternDeduplicatesAndKeepsViewsStable) {
+    NameArena arena;
+    std::vector<std::string_view> views;
+    for (int i = 0; i < 5000; i++) {
+        views.push_back(arena.intern("name" + std::to_string(i)));
+    }
+    std::string longName(100000, 'x');
+    std::string_view longView = arena.intern(longName);
+    EXPECT_EQ(arena.size(), 5001);
+    for (int i = 0; i < 5000; i++) {
+        std::string expected = "name" + std::to_string(i);
+        EXPECT_EQ(views[i], expected);
+        EXPECT_EQ(arena.intern(expected).data(), views[i].data());
+    }
+    EXPECT_EQ(longView, longName);
+    EXPECT_EQ(arena.intern("").size(), 0);
+    EXPECT_EQ(arena.size(), 5002);
+}
+
+TEST(NameArenaTest, NodesShareInternedNames) {
+    NameArena arena;
+    InodeTable table(&arena);
+    auto first = table.create("shared.txt", NodeType::FILE, nullptr);
+    auto second = table.create(std::string("shared") + ".txt", NodeType::FILE, nullptr);
+    EXPECT_EQ(first->name.data(), second->name.data());
+    EXPECT_EQ(arena.size(), 1);
+    first = nullptr;
+    EXPECT_EQ(second->name, "shared.txt");
+    second = nullptr;
+    EXPECT_EQ(arena.size(), 0);
+}
+
+TEST(NameArenaTest, ReleasedNamesAreReused) {
+    NameArena arena;
+    std::string_view kept = arena.intern("kept");
+    EXPECT_EQ(arena.retain(kept), kept);
+    arena.release(kept);
+    EXPECT_EQ(arena.size(), 1);
+    EXPECT_EQ(kept, "kept");
+
+    for (int i = 0; i < 200000; i++) {
+        std::string_view name = arena.intern("churn" + std::to_string(i));
+        EXPECT_EQ(arena.size(), 2);
+        arena.release(name);
+    }
+    EXPECT_EQ(arena.size(), 1);
+    EXPECT_LT(arena.memoryUsage(), 256u * 1024);
+    arena.release(kept);
+    EXPECT_EQ(arena.size(), 0);
+}
+
+TEST_F(AVLHTreeTest, BTreeSeparatorsSurviveRemovedNames) {
+    auto colliding = [](int bits) {
+        std::string name;
+        for (int b = 0; b < 12; b++) {
+            name += (bits >> b) & 1 ? "BB" : "Aa";
+        }
+        return name;
+    };
+    HTreeIndex index(0, 0);
+    std::vector<NodePtr> nodes;
+    for (int i = 0; i < 4096; i++) {
+        nodes.push_back(FSNode::create(colliding(i), NodeType::FILE));
+        index.insert(nodes.back()->name, nodes.back());
+    }
+    ASSERT_EQ(nodes[0]->nameHash, nodes[4095]->nameHash);
+    for (int i = 0; i < 2048; i++) {
+        EXPECT_TRUE(index.remove(nodes[i]->name));
+        nodes[i] = nullptr;
+    }
+    std::vector<NodePtr> fillers;
+    for (int i = 0; i < 2048; i++) {
+        fillers.push_back(FSNode::create("filler" + std::to_string(100000000000000000LL + i), NodeType::FILE));
+    }
+    EXPECT_TRUE(index.isBTree());
+    for (const auto& node : nodes) {
+        if (node) {
+            EXPECT_EQ(index.find(node->name), node) << node->name;
+        }
+    }
+    EXPECT_EQ(index.size(), 2048);
+}
+
+TEST_F(AVLHTreeTest, FilteredIndexFindsAllAfterGrowthAndShrink) {
+    for (int i = 0; i < 2000; i++) {
+        std::string name = "g" + std::to_string(i);
+        htree.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    EXPECT_GT(htree.filterMemoryUsage(), 0);
+    for (int i = 0; i < 2000; i++) {
+        EXPECT_NE(htree.find("g" + std::to_string(i)), nullptr);
+    }
+    EXPECT_EQ(htree.find("absent"), nullptr);
+
+    size_t bigFilter = htree.filterMemoryUsage();
+    for (int i = 0; i < 1950; i++) {
+        htree.remove("g" + std::to_string(i));
+    }
+    EXPECT_LT(htree.filterMemoryUsage(), bigFilter);
+    for (int i = 1950; i < 2000; i++) {
+        EXPECT_NE(htree.find("g" + std::to_string(i)), nullptr);
+    }
+    EXPECT_EQ(htree.find("g0"), nullptr);
+
+    htree.setFilterEnabled(false);
+    EXPECT_EQ(htree.filterMemoryUsage(), 0);
+    EXPECT_NE(htree.find("g1999"), nullptr);
+}
+
+static std::vector<std::string> collidingNames(int bits) {
+    std::vector<std::string> names;
+    for (int mask = 0; mask < (1 << bits); mask++) {
+        std::string name;
+        for (int i = 0; i < bits; i++) {
+            name += (mask >> i) & 1 ? "Aa" : "BB";
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+TEST_F(AVLHTreeTest, BTreeMatchesAVLUnderChurn) {
+    HTreeIndex btreeIndex(0, 0);
+    HTreeIndex avlIndex(0, SIZE_MAX);
+    std::mt19937 gen(7);
+    std::set<std::string> live;
+    for (int step = 0; step < 20000; step++) {
+        std::string name = "n" + std::to_string(gen() % 5000);
+        if (live.count(name)) {
+            EXPECT_TRUE(btreeIndex.remove(name));
+            EXPECT_TRUE(avlIndex.remove(name));
+            live.erase(name);
+        } else {
+            auto node = FSNode::create(name, NodeType::FILE);
+            btreeIndex.insert(name, node);
+            avlIndex.insert(name, node);
+            live.insert(name);
+        }
+    }
+    EXPECT_TRUE(btreeIndex.isBTree());
+    EXPECT_EQ(btreeIndex.size(), live.size());
+    EXPECT_EQ(btreeIndex.getAllNodes(), avlIndex.getAllNodes());
+    for (int i = 0; i < 5000; i++) {
+        std::string name = "n" + std::to_string(i);
+        EXPECT_EQ(btreeIndex.find(name) != nullptr, live.count(name) == 1) << name;
+    }
+}
+
+TEST_F(AVLHTreeTest, BTreeHandlesHashCollisionsAcrossLeaves) {
+    auto names = collidingNames(7);
+    uint32_t hash = HashFunction::hash(names[0]);
+    HTreeIndex btreeIndex(0, 0);
+    for (const auto& name : names) {
+        ASSERT_EQ(HashFunction::hash(name), hash);
+        btreeIndex.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    for (const auto& name : names) {
+        EXPECT_NE(btreeIndex.find(name), nullptr);
+    }
+    std::set<std::string> seen;
+    uint32_t lastHash = 0;
+    std::string lastName;
+    for (auto batch = btreeIndex.entriesAfter(0, "", 10); !batch.empty();
+            batch = btreeIndex.entriesAfter(lastHash, lastName, 10)) {
+        for (const auto& node : batch) {
+            EXPECT_TRUE(seen.emplace(node->name).second);
+        }
+        lastHash = HashFunction::hash(batch.back()->name);
+        lastName = batch.back()->name;
+    }
+    EXPECT_EQ(seen.size(), names.size());
+    for (size_t i = 0; i < names.size(); i += 2) {
+        EXPECT_TRUE(btreeIndex.remove(names[i]));
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        EXPECT_EQ(btreeIndex.find(names[i]) != nullptr, i % 2 == 1);
+    }
+}
+
+TEST_F(AVLHTreeTest, BTreePromotionAndDemotion) {
+    HTreeIndex index(HTreeIndex::INLINE_LIMIT, 100);
+    vector<pair<std::string, NodePtr>> items;
+    for (int i = 0; i < 150; i++) {
+        std::string name = "p" + std::to_string(i);
+        index.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    EXPECT_TRUE(index.isBTree());
+    for (int i = 0; i < 130; i++) {
+        index.remove("p" + std::to_string(i));
+    }
+    EXPECT_FALSE(index.isBTree());
+    EXPECT_FALSE(index.isInline());
+    for (int i = 130; i < 150; i++) {
+        EXPECT_NE(index.find("p" + std::to_string(i)), nullptr);
+    }
+}
+
+TEST_F(AVLHTreeTest, FrozenMatchesAVL) {
+    HTreeIndex frozenIndex;
+    HTreeIndex avlIndex(0, SIZE_MAX);
+    for (int i = 0; i < 1000; i++) {
+        std::string name = "z" + std::to_string(i);
+        auto node = FSNode::create(name, NodeType::FILE);
+        frozenIndex.insert(name, node);
+        avlIndex.insert(name, node);
+    }
+    frozenIndex.freeze();
+    EXPECT_TRUE(frozenIndex.isFrozen());
+    EXPECT_EQ(frozenIndex.size(), 1000);
+    for (int i = 0; i < 1100; i++) {
+        std::string name = "z" + std::to_string(i);
+        EXPECT_EQ(frozenIndex.find(name), avlIndex.find(name)) << name;
+    }
+    auto frozenBatch = frozenIndex.entriesAfter(0, "", SIZE_MAX);
+    auto avlBatch = avlIndex.entriesAfter(0, "", SIZE_MAX);
+    EXPECT_EQ(frozenBatch, avlBatch);
+    EXPECT_EQ(frozenIndex.prefixRange("z99").size(), 11);
+}
+
+TEST_F(AVLHTreeTest, FrozenHandlesHashCollisions) {
+    auto names = collidingNames(6);
+    HTreeIndex index;
+    for (const auto& name : names) {
+        index.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    index.freeze();
+    for (const auto& name : names) {
+        ASSERT_NE(index.find(name), nullptr);
+        EXPECT_EQ(index.find(name)->name, name);
+    }
+    std::set<std::string> seen;
+    uint32_t lastHash = 0;
+    std::string lastName;
+    for (auto batch = index.entriesAfter(0, "", 7); !batch.empty();
+            batch = index.entriesAfter(lastHash, lastName, 7)) {
+        for (const auto& node : batch) {
+            EXPECT_TRUE(seen.emplace(node->name).second);
+        }
+        lastHash = HashFunction::hash(batch.back()->name);
+        lastName = batch.back()->name;
+    }
+    EXPECT_EQ(seen.size(), names.size());
+}
+
+TEST_F(AVLHTreeTest, WriteThawsFrozenIndex) {
+    HTreeIndex index;
+    for (int i = 0; i < 100; i++) {
+        std::string name = "w" + std::to_string(i);
+        index.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    index.freeze();
+    index.insert("extra", FSNode::create("extra", NodeType::FILE));
+    EXPECT_FALSE(index.isFrozen());
+    EXPECT_EQ(index.size(), 101);
+    EXPECT_NE(index.find("extra"), nullptr);
+
+    index.freeze();
+    for (int i = 0; i < 97; i++) {
+        EXPECT_TRUE(index.remove("w" + std::to_string(i)));
+    }
+    EXPECT_FALSE(index.isFrozen());
+    EXPECT_TRUE(index.isInline());
+    EXPECT_NE(index.find("w99"), nullptr);
+    EXPECT_EQ(index.find("w0"), nullptr);
+}
+
+TEST_F(AVLHTreeTest, AVLHandlesHashCollisionsOnRemove) {
+    auto names = collidingNames(7);
+    HTreeIndex index(0, SIZE_MAX);
+    for (const auto& name : names) {
+        index.insert(name, FSNode::create(name, NodeType::FILE));
+    }
+    for (size_t i = 0; i < names.size(); i += 2) {
+        EXPECT_TRUE(index.remove(names[i]));
+        EXPECT_FALSE(index.remove(names[i]));
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        EXPECT_EQ(index.find(names[i]) != nullptr, i % 2 == 1);
+    }
+    EXPECT_EQ(index.getAllNodes().size(), names.size() / 2);
+}
+
+TEST_F(AVLHTreeTest, FindManyMatchesFind) {
+    std::vector<std::string> probes;
+    for (int i = 0; i < 300; i++) {
+        probes.push_back("m" + std::to_string(i * 7 % 400));
+    }
+    for (int size : {5, 200}) {
+        for (int mode = 0; mode < 3; mode++) {
+            HTreeIndex index(HTreeIndex::INLINE_LIMIT, mode == 1 ? 0 : SIZE_MAX);
+            for (int i = 0; i < size; i++) {
+                std::string name = "m" + std::to_string(i);
+                index.insert(name, FSNode::create(name, NodeType::FILE));
+            }
+            if (mode == 2) {
+                index.freeze();
+            }
+            auto batch = index.findMany(probes);
+            ASSERT_EQ(batch.size(), probes.size());
+            for (size_t i = 0; i < probes.size(); i++) {
+                EXPECT_EQ(batch[i], index.find(probes[i])) << probes[i];
+            }
+        }
+    }
+}
+
+TEST_F(AVLHTreeTest, ReplaceSwapsEntryInEveryLayout) {
+    for (int size : {5, 200}) {
+        for (int mode = 0; mode < 3; mode++) {
+            HTreeIndex index(HTreeIndex::INLINE_LIMIT, mode == 1 ? 0 : SIZE_MAX);
+            for (int i = 0; i < size; i++) {
+                std::string name = "r" + std::to_string(i);
+                index.insert(name, FSNode::create(name, NodeType::FILE));
+            }
+            if (mode == 2) {
+                index.freeze();
+            }
+            NodePtr old = index.find("r3");
+            NodePtr next = FSNode::create("r3", NodeType::DIRECTORY);
+            EXPECT_TRUE(index.replace(next));
+            EXPECT_FALSE(index.replace(FSNode::create("absent", NodeType::FILE)));
+            EXPECT_EQ(index.find("r3"), next);
+            EXPECT_EQ(index.size(), (size_t)size);
+            EXPECT_EQ(old->useCount(), 1u);
+            EXPECT_EQ(index.lowerBound("r3", 1).front(), next);
+        }
+    }
+}
+
 class FSNodeTest : public ::testing::Test {
 protected:
-    shared_ptr<FSNode> dirNode;
-    shared_ptr<FSNode> fileNode;
+    NodePtr dirNode;
+    NodePtr fileNode;
 
     void SetUp() override {
-        dirNode = make_shared<FSNode>("testdir", NodeType::DIRECTORY);
-        fileNode = make_shared<FSNode>("testfile.txt", NodeType::FILE);
+        dirNode = FSNode::create("testdir", NodeType::DIRECTORY);
+        fileNode = FSNode::create("testfile.txt", NodeType::FILE);
     }
 };
 
@@ -236,13 +783,13 @@ TEST_F(FSNodeTest, IsFile) {
 }
 
 TEST_F(FSNodeTest, AddChild) {
-    auto child = make_shared<FSNode>("child.txt", NodeType::FILE);
+    auto child = FSNode::create("child.txt", NodeType::FILE);
     dirNode->addChild(child, true);
-    EXPECT_EQ(dirNode->htree.size(), 1);
+    EXPECT_EQ(dirNode->htree().size(), 1);
 }
 
 TEST_F(FSNodeTest, FindChild) {
-    auto child = make_shared<FSNode>("child.txt", NodeType::FILE);
+    auto child = FSNode::create("child.txt", NodeType::FILE);
     dirNode->addChild(child, true);
     auto found = dirNode->findChild("child.txt");
     EXPECT_NE(found, nullptr);
@@ -250,15 +797,15 @@ TEST_F(FSNodeTest, FindChild) {
 }
 
 TEST_F(FSNodeTest, RemoveChild) {
-    auto child = make_shared<FSNode>("child.txt", NodeType::FILE);
+    auto child = FSNode::create("child.txt", NodeType::FILE);
     dirNode->addChild(child, true);
     EXPECT_TRUE(dirNode->removeChild("child.txt"));
-    EXPECT_EQ(dirNode->htree.size(), 0);
+    EXPECT_EQ(dirNode->htree().size(), 0);
 }
 
 TEST_F(FSNodeTest, GetChildren) {
-    dirNode->addChild(make_shared<FSNode>("file1.txt", NodeType::FILE), true);
-    dirNode->addChild(make_shared<FSNode>("file2.txt", NodeType::FILE), true);
+    dirNode->addChild(FSNode::create("file1.txt", NodeType::FILE), true);
+    dirNode->addChild(FSNode::create("file2.txt", NodeType::FILE), true);
     auto children = dirNode->getChildren();
     EXPECT_EQ(children.size(), 2);
 }
@@ -273,9 +820,138 @@ TEST_F(FSNodeTest, Permissions) {
 }
 
 TEST_F(FSNodeTest, FileContent) {
-    fileNode->content = Rope("Hello World");
-    EXPECT_EQ(fileNode->content.toString(), "Hello World");
-    EXPECT_EQ(fileNode->content.length(), 11);
+    fileNode->content() = Rope("Hello World");
+    EXPECT_EQ(fileNode->content().toString(), "Hello World");
+    EXPECT_EQ(fileNode->content().length(), 11);
+}
+
+TEST_F(FSNodeTest, CompactLayout) {
+    EXPECT_EQ(sizeof(Permissions), 2);
+    EXPECT_EQ(fileNode->permissions.mode(), 0755);
+    fileNode->permissions.group = 0;
+    EXPECT_EQ(fileNode->permissions.mode(), 0705);
+    EXPECT_EQ(fileNode->permissions.toString(), "rwx---r-x");
+    EXPECT_TRUE(dirNode->htree().empty());
+    EXPECT_TRUE(fileNode->content().empty());
+    EXPECT_THROW(fileNode->htree(), std::bad_variant_access);
+    EXPECT_THROW(dirNode->content(), std::bad_variant_access);
+}
+
+TEST_F(FSNodeTest, CachedNameHash) {
+    EXPECT_EQ(fileNode->nameHash, HashFunction::hash("testfile.txt"));
+    dirNode->addChild(fileNode, true);
+    EXPECT_EQ(dirNode->findChild("testfile.txt", fileNode->nameHash), fileNode);
+    EXPECT_EQ(dirNode->findChild("testfile.txt", fileNode->nameHash + 1), nullptr);
+    EXPECT_FALSE(dirNode->removeChild("testfile.txt", fileNode->nameHash + 1));
+    EXPECT_TRUE(dirNode->removeChild("testfile.txt", fileNode->nameHash));
+}
+
+TEST(InodeTableTest, StaleRefAfterRemovalAndSlotReuse) {
+    NameArena arena;
+    InodeTable table(&arena);
+    auto dir = table.create("dir", NodeType::DIRECTORY, nullptr);
+    dir->addChild(table.create("a.txt", NodeType::FILE, dir.get()), true);
+    InodeRef ref = table.ref(dir->findChild("a.txt").get());
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(table.resolve(ref)->name, "a.txt");
+
+    EXPECT_TRUE(dir->removeChild("a.txt"));
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_EQ(table.resolve(ref), nullptr);
+
+    auto reused = table.create("b.txt", NodeType::FILE, dir.get());
+    EXPECT_EQ(reused->ino, ref.ino);
+    EXPECT_EQ(table.resolve(ref), nullptr);
+    EXPECT_EQ(table.resolve(table.ref(reused.get())), reused);
+    EXPECT_EQ(table.capacity(), 2);
+}
+
+TEST(InodeTableTest, HandlesCountReferences) {
+    auto dir = FSNode::create("dir", NodeType::DIRECTORY);
+    auto file = FSNode::create("file.txt", NodeType::FILE, dir.get());
+    EXPECT_EQ(file->useCount(), 1);
+    dir->addChild(file, true);
+    EXPECT_EQ(file->useCount(), 2);
+    {
+        NodePtr copy = file;
+        NodePtr found = dir->findChild("file.txt");
+        EXPECT_EQ(file->useCount(), 4);
+        NodePtr moved = std::move(copy);
+        EXPECT_EQ(file->useCount(), 4);
+    }
+    EXPECT_EQ(file->useCount(), 2);
+    EXPECT_TRUE(dir->removeChild("file.txt"));
+    EXPECT_EQ(file->useCount(), 1);
+}
+
+TEST(InodeTableTest, DroppingDirectoryReleasesSubtree) {
+    NameArena arena;
+    InodeTable table(&arena);
+    auto root = table.create("", NodeType::DIRECTORY, nullptr);
+    auto current = root;
+    for (int depth = 0; depth < 50; depth++) {
+        auto dir = table.create("d" + std::to_string(depth), NodeType::DIRECTORY, current.get());
+        for (int i = 0; i < 20; i++) {
+            dir->addChild(table.create("f" + std::to_string(i), NodeType::FILE, dir.get()), true);
+        }
+        current->addChild(dir, true);
+        current = dir;
+    }
+    EXPECT_EQ(table.size(), 1 + 50 * 21);
+
+    std::vector<FSNode*> raw;
+    current->appendChildren(raw);
+    auto children = current->getChildren();
+    ASSERT_EQ(raw.size(), children.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+        EXPECT_EQ(raw[i], children[i].get());
+    }
+
+    children.clear();
+    current = nullptr;
+    root = nullptr;
+    EXPECT_EQ(table.size(), 0);
+}
+
+TEST(InodeTableTest, ParentHandleIsNullOnceParentIsGone) {
+    NameArena arena;
+    InodeTable table(&arena);
+    auto dir = table.create("dir", NodeType::DIRECTORY, nullptr);
+    auto file = table.create("f.txt", NodeType::FILE, dir.get());
+    dir->addChild(file, true);
+    EXPECT_EQ(file->parentHandle(), dir);
+    EXPECT_EQ(dir->parentHandle(), nullptr);
+
+    dir = nullptr;
+    EXPECT_EQ(file->parentHandle(), nullptr);
+    EXPECT_EQ(table.size(), 1);
+}
+
+TEST(LookupTableTest, InsertEraseAndRebuild) {
+    LookupTable lookup;
+    auto contains = [&lookup](uint32_t hash, uint32_t ino) {
+        const LookupSlots* slots = lookup.load();
+        for (size_t i = slots->start(hash);; i = (i + 1) & slots->mask) {
+            uint64_t value = slots->slots[i].load();
+            if (value == LookupTable::EMPTY) return false;
+            if (value == LookupTable::pack(hash, ino)) return true;
+        }
+    };
+    for (uint32_t i = 0; i < 1000; i++) {
+        lookup.insert(i * 7 % 64, i);
+    }
+    size_t grown = lookup.memoryUsage();
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        lookup.erase(i * 7 % 64, i);
+    }
+    for (uint32_t i = 0; i < 1000; i++) {
+        EXPECT_EQ(contains(i * 7 % 64, i), i % 2 == 1) << i;
+    }
+    for (uint32_t i = 1; i < 1000; i += 2) {
+        lookup.erase(i * 7 % 64, i);
+    }
+    EXPECT_LT(lookup.memoryUsage(), grown);
+    EXPECT_FALSE(contains(7, 1));
 }
 
 class FileSystemTest : public ::testing::Test {
@@ -326,6 +1002,843 @@ TEST_F(FileSystemTest, ChangeDirectoryParent) {
     EXPECT_EQ(fs->getCurrentPath(), "/");
 }
 
+TEST_F(FileSystemTest, ParentNavigationAtDepth) {
+    testing::internal::CaptureStdout();
+    std::string path;
+    for (int i = 0; i < 40; i++) {
+        path += "/d" + std::to_string(i);
+        fs->createDirectory(path, true);
+    }
+    fs->createFile("/d0/top.txt", "top", true);
+    EXPECT_TRUE(fs->changeDirectory(path));
+    std::string up;
+    for (int i = 0; i < 39; i++) {
+        up += "../";
+    }
+    EXPECT_EQ(fs->findInFile(up + "top.txt", "top"), 0);
+    EXPECT_EQ(fs->findInFile(up + "../../../d0/top.txt", "top"), 0);
+    EXPECT_TRUE(fs->changeDirectory(up + "d1/.."));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->getCurrentPath(), "/d0");
+}
+
+TEST_F(FileSystemTest, ParentOfDetachedDirectory) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/a", true);
+    fs->createDirectory("/a/b", true);
+    EXPECT_TRUE(fs->changeDirectory("/a/b"));
+    EXPECT_TRUE(fs->rm("/a", true));
+    EXPECT_TRUE(fs->changeDirectory(".."));
+    EXPECT_TRUE(fs->changeDirectory("/"));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->findInFile("/a/b", "x"), -1);
+}
+
+TEST_F(FileSystemTest, PathCacheHitsAndInvalidation) {
+    testing::internal::CaptureStdout();
+    fs->setPathCacheEnabled(true);
+    fs->createDirectory("/a", true);
+    fs->createDirectory("/a/b", true);
+    fs->createFile("/a/b/f.txt", "one", true);
+    EXPECT_EQ(fs->readFile("/a/b/f.txt"), "one");
+    EXPECT_EQ(fs->readFile("//a/./b/f.txt"), "one");
+    EXPECT_EQ(fs->pathCacheStats().hits, 1);
+
+    EXPECT_EQ(fs->readFile("/a/b/g.txt"), "");
+    EXPECT_EQ(fs->readFile("/a/b/g.txt"), "");
+    EXPECT_EQ(fs->pathCacheStats().negativeHits, 1);
+    EXPECT_TRUE(fs->writeFile("/a/b/g.txt", "two"));
+    EXPECT_EQ(fs->readFile("/a/b/g.txt"), "two");
+
+    EXPECT_TRUE(fs->chmod("700", "/a/b/f.txt"));
+    EXPECT_GT(fs->pathCacheStats().invalidations, 0);
+    EXPECT_TRUE(fs->rm("/a/b", true));
+    EXPECT_EQ(fs->readFile("/a/b/f.txt"), "");
+    EXPECT_EQ(fs->readFile("/a/b/g.txt"), "");
+    fs->createDirectory("/a/b", true);
+    fs->createFile("/a/b/f.txt", "three", true);
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/a/b/f.txt"), "three");
+    EXPECT_GT(fs->pathCacheStats().hitRate(), 0.0);
+}
+
+TEST_F(FileSystemTest, PathCacheMatchesUncachedResolution) {
+    testing::internal::CaptureStdout();
+    fs->setPathCacheEnabled(true);
+    FileSystem plain;
+    plain.setPathCacheEnabled(false);
+    std::mt19937 gen(11);
+    for (int step = 0; step < 3000; step++) {
+        std::string path;
+        int depth = 1 + gen() % 4;
+        for (int i = 0; i < depth; i++) {
+            path += "/n" + std::to_string(gen() % 3);
+        }
+        switch (gen() % 5) {
+            case 0:
+                EXPECT_EQ(fs->createDirectory(path, true), plain.createDirectory(path, true)) << path;
+                break;
+            case 1:
+                EXPECT_EQ(fs->createFile(path, path, true), plain.createFile(path, path, true)) << path;
+                break;
+            case 2:
+                EXPECT_EQ(fs->rm(path, true), plain.rm(path, true)) << path;
+                break;
+            default:
+                EXPECT_EQ(fs->readFile(path), plain.readFile(path)) << path;
+                break;
+        }
+    }
+    testing::internal::GetCapturedStdout();
+    EXPECT_GT(fs->pathCacheStats().hits + fs->pathCacheStats().negativeHits, 0);
+    EXPECT_EQ(plain.pathCacheStats().entries, 0);
+}
+
+TEST_F(FileSystemTest, TransactionCommitsGroupAtomically) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/cfg", true);
+    fs->createFile("/cfg/a", "a1", true);
+    fs->createFile("/cfg/old", "x", true);
+
+    Transaction tx = fs->beginTransaction();
+    tx.write("/cfg/a", "a2");
+    tx.write("/cfg/b", "b2");
+    tx.remove("/cfg/old");
+    EXPECT_EQ(tx.read("/cfg/a"), "a2");
+    EXPECT_EQ(tx.read("/cfg/old"), "");
+    EXPECT_EQ(fs->readFile("/cfg/a"), "a1");
+    EXPECT_EQ(fs->readFile("/cfg/b"), "");
+    EXPECT_EQ(fs->readFile("/cfg/old"), "x");
+    EXPECT_EQ(tx.pendingCount(), 3);
+
+    EXPECT_TRUE(tx.commit());
+    EXPECT_FALSE(tx.isActive());
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/cfg/a"), "a2");
+    EXPECT_EQ(fs->readFile("/cfg/b"), "b2");
+    EXPECT_EQ(fs->readFile("/cfg/old"), "");
+}
+
+TEST_F(FileSystemTest, TransactionConflictAppliesNothing) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/cfg", true);
+    fs->createFile("/cfg/a", "a1", true);
+
+    Transaction tx = fs->beginTransaction();
+    EXPECT_EQ(tx.read("/cfg/a"), "a1");
+    tx.write("/cfg/b", "b1");
+    fs->writeFile("/cfg/a", "changed");
+    EXPECT_EQ(tx.read("/cfg/a"), "changed");
+    EXPECT_FALSE(tx.commit());
+    EXPECT_EQ(fs->readFile("/cfg/b"), "");
+
+    Transaction missing = fs->beginTransaction();
+    missing.write("/cfg/c", "c1");
+    missing.write("/nowhere/d", "d1");
+    EXPECT_FALSE(missing.commit());
+    EXPECT_EQ(fs->readFile("/cfg/c"), "");
+
+    Transaction nested = fs->beginTransaction();
+    nested.remove("/cfg");
+    nested.write("cfg/../cfg/e", "e1");
+    EXPECT_EQ(nested.read("/cfg/a"), "");
+    EXPECT_FALSE(nested.commit());
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/cfg/a"), "changed");
+}
+
+TEST_F(FileSystemTest, TransactionRejectsSnapshotMount) {
+    testing::internal::CaptureStdout();
+    fs->createFile("/a", "a1", true);
+    EXPECT_TRUE(fs->snapshot("s"));
+
+    Transaction tx = fs->beginTransaction();
+    tx.write("/a", "a2");
+    tx.write("/.snapshots", "x");
+    EXPECT_FALSE(tx.isActive());
+    EXPECT_FALSE(tx.commit());
+
+    Transaction relative = fs->beginTransaction();
+    relative.write(".snapshots", "x");
+    EXPECT_FALSE(relative.commit());
+
+    Transaction inside = fs->beginTransaction();
+    inside.remove("/.snapshots/s/a");
+    EXPECT_FALSE(inside.commit());
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find("только для чтения"), string::npos);
+    EXPECT_EQ(fs->readFile("/a"), "a1");
+    EXPECT_EQ(fs->readFile("/.snapshots/s/a"), "a1");
+    EXPECT_EQ(fs->search(".snap").size(), 0u);
+}
+
+TEST_F(FileSystemTest, SnapshotKeepsTreeAsOfCreation) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/docs", true);
+    fs->createFile("/docs/a", "a1", true);
+    fs->createFile("/docs/b", "b1", true);
+    EXPECT_TRUE(fs->snapshot("s1"));
+
+    fs->writeFile("/docs/a", "a2");
+    fs->rm("/docs/b");
+    fs->createFile("/docs/c", "c2", true);
+    fs->createDirectory("/.snapshots", true);
+    fs->chmod("000", "/docs");
+    EXPECT_FALSE(fs->snapshot("s1"));
+    EXPECT_TRUE(fs->snapshot("s2"));
+    fs->chmod("755", "/docs");
+    fs->appendFile("/docs/c", "+");
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/.snapshots/s1/docs/a"), "a1");
+    EXPECT_EQ(fs->readFile("/.snapshots/s1/docs/b"), "b1");
+    EXPECT_EQ(fs->readFile("/.snapshots/s1/docs/c"), "");
+    EXPECT_EQ(fs->readFile("/.snapshots/s2/docs/c"), "c2");
+    EXPECT_EQ(fs->readFile("/.snapshots/s1/docs/../docs/a"), "a1");
+    EXPECT_EQ(fs->readFile("/docs/a"), "a2");
+    EXPECT_EQ(fs->readFile("/docs/c"), "c2+");
+    EXPECT_EQ(fs->listSnapshots(), (vector<string>{"s1", "s2"}));
+
+    testing::internal::CaptureStdout();
+    fs->ls(string("/.snapshots/s1/docs"));
+    fs->ls(string("/.snapshots/s2/docs"));
+    fs->ls(string("/.snapshots"));
+    string output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("b  "), string::npos);
+    EXPECT_NE(output.find("Отказано в доступе"), string::npos);
+    EXPECT_NE(output.find("s2/"), string::npos);
+}
+
+TEST_F(FileSystemTest, SnapshotUndoesLaterDirectoryChanges) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/d", true);
+    fs->createFile("/d/a", "a1", true);
+    fs->createFile("/d/b", "b1", true);
+    EXPECT_TRUE(fs->snapshot("s"));
+
+    EXPECT_TRUE(fs->rename("/d/a", "/d/b"));
+    fs->createFile("/d/tmp", "t", true);
+    fs->rm("/d/tmp");
+    fs->createFile("/d/a", "a2", true);
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/.snapshots/s/d/a"), "a1");
+    EXPECT_EQ(fs->readFile("/.snapshots/s/d/b"), "b1");
+    EXPECT_EQ(fs->readFile("/.snapshots/s/d/tmp"), "");
+    EXPECT_EQ(fs->readFile("/d/a"), "a2");
+    EXPECT_EQ(fs->readFile("/d/b"), "a1");
+
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(fs->cp("/.snapshots/s/d", "/restored", true));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->openDir("/restored").dir->htree().size(), 2u);
+    EXPECT_EQ(fs->readFile("/restored/a"), "a1");
+    EXPECT_EQ(fs->readFile("/restored/b"), "b1");
+}
+
+TEST(SnapshotTest, DirectoryKeepsOnlyChangedEntries) {
+    auto dir = FSNode::create("d", NodeType::DIRECTORY);
+    for (int i = 0; i < 100; i++) {
+        dir->addChild(FSNode::create("f" + std::to_string(i), NodeType::FILE, dir.get()), true);
+    }
+    Snapshot snap("s", 1);
+    NodePtr victim = dir->findChild("f7");
+    snap.preserve(dir.get(), victim->name, victim->nameHash, victim);
+    dir->removeChild(victim->name, victim->nameHash);
+    snap.preserve(dir.get(), victim->name, victim->nameHash, nullptr);
+
+    const PreservedNode* kept = snap.find(dir->ino);
+    ASSERT_NE(kept, nullptr);
+    EXPECT_EQ(kept->changes.size(), 1u);
+    NodeView view;
+    view.capture(dir.get(), kept);
+    EXPECT_EQ(view.children.size(), 100u);
+    snap.preserve(dir.get());
+    EXPECT_EQ(snap.preservedCount(), 1u);
+}
+
+TEST_F(FileSystemTest, DeletedSnapshotIsUnmounted) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/tmp", true);
+    fs->createFile("/tmp/big", string(1000, 'x'), true);
+    EXPECT_TRUE(fs->snapshot("backup"));
+    fs->rm("/tmp", true);
+    EXPECT_EQ(fs->readFile("/.snapshots/backup/tmp/big").size(), 1000u);
+
+    EXPECT_TRUE(fs->deleteSnapshot("backup"));
+    EXPECT_FALSE(fs->deleteSnapshot("backup"));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/.snapshots/backup/tmp/big"), "");
+    EXPECT_TRUE(fs->listSnapshots().empty());
+}
+
+TEST_F(FileSystemTest, SnapshotMountRejectsWrites) {
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(fs->snapshot("s"));
+    EXPECT_FALSE(fs->writeFile("/.snapshots", "x"));
+    EXPECT_FALSE(fs->writeFile(".snapshots", "x"));
+    EXPECT_FALSE(fs->appendFile("/.snapshots", "x"));
+    EXPECT_FALSE(fs->appendFile(".snapshots", "x"));
+    EXPECT_FALSE(fs->writeFile("/.snapshots/s/f", "x"));
+    EXPECT_FALSE(fs->touch(".snapshots"));
+    EXPECT_FALSE(fs->touch("/.snapshots/f"));
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_NE(output.find("только для чтения"), string::npos);
+    EXPECT_EQ(fs->listSnapshots(), (vector<string>{"s"}));
+    EXPECT_EQ(fs->search(".snapshots").size(), 0u);
+}
+
+TEST_F(FileSystemTest, CopyClonesFilesAndTrees) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/src", true);
+    fs->createDirectory("/src/sub", true);
+    fs->createFile("/src/a", "alpha", true);
+    fs->createFile("/src/sub/b", "beta", true);
+    fs->createDirectory("/dst", true);
+
+    EXPECT_TRUE(fs->cp("/src/a", "/src/a2"));
+    EXPECT_TRUE(fs->cp("/src/a", "/dst"));
+    EXPECT_FALSE(fs->cp("/src", "/copy"));
+    EXPECT_TRUE(fs->cp("/src", "/copy", true));
+    EXPECT_TRUE(fs->cp("/src", "/dst", true));
+    EXPECT_FALSE(fs->cp("/src", "/src/sub", true));
+    EXPECT_FALSE(fs->cp("/src/a", "/src/a"));
+    EXPECT_FALSE(fs->cp("/missing", "/x"));
+
+    fs->appendFile("/copy/sub/b", "2");
+    fs->writeFile("/src/a", "changed");
+    EXPECT_TRUE(fs->cp("/src/a", "/src/a2"));
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/src/a2"), "changed");
+    EXPECT_EQ(fs->readFile("/dst/a"), "alpha");
+    EXPECT_EQ(fs->readFile("/copy/a"), "alpha");
+    EXPECT_EQ(fs->readFile("/copy/sub/b"), "beta2");
+    EXPECT_EQ(fs->readFile("/src/sub/b"), "beta");
+    EXPECT_EQ(fs->readFile("/dst/src/sub/b"), "beta");
+    EXPECT_EQ(fs->search("sub").size(), 3u);
+}
+
+TEST_F(FileSystemTest, CopyRestoresFromSnapshot) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/docs", true);
+    fs->createFile("/docs/a", "v1", true);
+    fs->snapshot("before");
+    fs->writeFile("/docs/a", "v2");
+    fs->rm("/docs", true);
+
+    EXPECT_TRUE(fs->cp("/.snapshots/before/docs", "/", true));
+    EXPECT_FALSE(fs->cp("/docs", "/.snapshots/before/x", true));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/docs/a"), "v1");
+}
+
+TEST_F(FileSystemTest, RenameRelinksSubtreeInPlace) {
+    testing::internal::CaptureStdout();
+    fs->setPathCacheEnabled(true);
+    fs->createDirectory("/a", true);
+    fs->createDirectory("/a/deep", true);
+    fs->createFile("/a/deep/f", "data", true);
+    fs->createDirectory("/b", true);
+    EXPECT_EQ(fs->readFile("/a/deep/f"), "data");
+    EXPECT_TRUE(fs->changeDirectory("/a/deep"));
+
+    EXPECT_TRUE(fs->rename("/a/deep", "/b/moved"));
+    EXPECT_EQ(fs->getCurrentPath(), "/b/moved");
+    EXPECT_TRUE(fs->touch("g"));
+    EXPECT_TRUE(fs->mv("/b/moved/g", "/a"));
+    EXPECT_TRUE(fs->mv("/b/moved/f", "renamed"));
+    EXPECT_FALSE(fs->rename("/b", "/b/moved/inner"));
+    EXPECT_FALSE(fs->rename("/missing", "/x"));
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/a/deep/f"), "");
+    EXPECT_EQ(fs->readFile("/b/moved/renamed"), "data");
+    EXPECT_EQ(fs->search("g").size(), 1u);
+    EXPECT_NE(fs->openDir("/a").dir->findChild("g"), nullptr);
+}
+
+TEST_F(FileSystemTest, RenameReplacesExistingTarget) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/d", true);
+    fs->createFile("/d/new", "fresh", true);
+    fs->createFile("/d/old", "stale", true);
+    fs->createDirectory("/d/empty", true);
+    fs->createDirectory("/d/full", true);
+    fs->createFile("/d/full/x", "", true);
+    fs->snapshot("s");
+
+    EXPECT_TRUE(fs->rename("/d/new", "/d/old"));
+    EXPECT_FALSE(fs->rename("/d/old", "/d/empty"));
+    EXPECT_FALSE(fs->rename("/d/empty", "/d/old"));
+    EXPECT_FALSE(fs->rename("/d/empty", "/d/full"));
+    EXPECT_TRUE(fs->rename("/d/full", "/d/empty"));
+    EXPECT_TRUE(fs->rename("/d/old", "/d/old"));
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/d/old"), "fresh");
+    EXPECT_EQ(fs->readFile("/d/new"), "");
+    EXPECT_EQ(fs->readFile("/d/empty/x"), "");
+    EXPECT_EQ(fs->openDir("/d/full").dir, nullptr);
+    EXPECT_NE(fs->openDir("/d/empty").dir, nullptr);
+    EXPECT_EQ(fs->readFile("/.snapshots/s/d/new"), "fresh");
+    EXPECT_EQ(fs->readFile("/.snapshots/s/d/old"), "stale");
+    EXPECT_NE(fs->openDir("/d").dir->findChild("empty")->findChild("x"), nullptr);
+}
+
+TEST_F(FileSystemTest, DiskUsageFollowsEveryMutation) {
+    auto expectUsage = [this](const std::string& path, int64_t bytes, int64_t files, int64_t dirs) {
+        Usage usage = fs->usage(path);
+        EXPECT_EQ(usage.bytes, bytes) << path;
+        EXPECT_EQ(usage.files, files) << path;
+        EXPECT_EQ(usage.dirs, dirs) << path;
+    };
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/a", true);
+    fs->createFile("/a/f", "hello", true);
+    fs->createDirectory("/a/sub", true);
+    fs->createFile("/a/sub/g", "xy", true);
+    expectUsage("/a", 7, 2, 2);
+    fs->appendFile("/a/sub/g", "z");
+    fs->insertInFile("/a/f", 0, "!!");
+    fs->deleteFromFile("/a/f", "he");
+    fs->writeToFile("/a/f", "?");
+    expectUsage("/a", 9, 2, 2);
+    expectUsage("/a/f", 6, 1, 0);
+    
+    fs->cp("/a", "/b", true);
+    fs->writeFile("/b/f", "");
+    expectUsage("/b", 3, 2, 2);
+    expectUsage("/", 12, 4, 5);
+    fs->mv("/b/sub", "/a/sub2");
+    expectUsage("/a", 12, 3, 3);
+    expectUsage("/b", 0, 1, 1);
+    fs->rm("/a/sub", true);
+    expectUsage("/a", 9, 2, 2);
+    
+    Transaction tx = fs->beginTransaction();
+    tx.write("/b/f", "1234");
+    tx.write("/b/new", "56");
+    tx.remove("/a/sub2/g");
+    EXPECT_TRUE(tx.commit());
+    expectUsage("/a", 6, 1, 2);
+    expectUsage("/b", 6, 2, 1);
+    fs->rename("/b/new", "/a/f");
+    expectUsage("/a", 2, 1, 2);
+    expectUsage("/", 6, 2, 4);
+    testing::internal::GetCapturedStdout();
+    
+    testing::internal::CaptureStdout();
+    fs->du("/a", true);
+    fs->ls(std::string("/"), true);
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("2\t/a  (файлов: 1, каталогов: 2)"), std::string::npos);
+    EXPECT_NE(output.find(std::string(9, ' ') + "4  "), std::string::npos);
+}
+
+TEST_F(FileSystemTest, ParallelSearchKeepsTreeOrder) {
+    testing::internal::CaptureStdout();
+    for (int d = 0; d < 30; d++) {
+        std::string dir = "/d" + std::to_string(d);
+        fs->createDirectory(dir, true);
+        for (int s = 0; s < 5; s++) {
+            std::string sub = dir + "/s" + std::to_string(s);
+            fs->createDirectory(sub, true);
+            for (int f = 0; f < 12; f++) {
+                fs->createFile(sub + "/file" + std::to_string(f), "", true);
+            }
+        }
+    }
+    std::vector<std::string> expected;
+    std::function<void(const NodePtr&, const std::string&)> walk = [&](const NodePtr& dir, const std::string& path) {
+        for (const auto& child : dir->getChildren()) {
+            std::string childPath = path + "/" + std::string(child->name);
+            if (child->name.find("1") != std::string_view::npos) {
+                expected.push_back(childPath);
+            }
+            if (child->isDirectory()) {
+                walk(child, childPath);
+            }
+        }
+    };
+    walk(fs->openDir("/").dir, "");
+    
+    fs->setWalkThreads(1);
+    auto sequential = fs->search("1");
+    fs->setWalkThreads(4);
+    auto parallel = fs->search("1");
+    fs->changeDirectory("/d1");
+    testing::internal::GetCapturedStdout();
+    
+    EXPECT_EQ(sequential, expected);
+    EXPECT_EQ(parallel, expected);
+    testing::internal::CaptureStdout();
+    fs->findFiles("file11");
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(output.find("/d1/s0/file11\n/d1/s1/file11"), 0u);
+}
+
+TEST_F(FileSystemTest, RemoveReclaimsSubtreeLater) {
+    testing::internal::CaptureStdout();
+    size_t baseline = fs->nodeCount();
+    fs->createDirectory("/big", true);
+    for (int d = 0; d < 20; d++) {
+        std::string dir = "/big/d" + std::to_string(d);
+        fs->createDirectory(dir, true);
+        for (int f = 0; f < 200; f++) {
+            fs->createFile(dir + "/f" + std::to_string(f), "x", true);
+        }
+    }
+    EXPECT_TRUE(fs->changeDirectory("/big/d3"));
+    EXPECT_TRUE(fs->rm("/big", true));
+    EXPECT_EQ(fs->openDir("/big").dir, nullptr);
+    EXPECT_TRUE(fs->changeDirectory("/"));
+    fs->waitForReclaim();
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->pendingReclaim(), 0u);
+    EXPECT_EQ(fs->nodeCount(), baseline);
+}
+
+TEST_F(FileSystemTest, DeepTreeIsReclaimedIteratively) {
+    testing::internal::CaptureStdout();
+    size_t baseline = fs->nodeCount();
+    fs->mkdir("/c0");
+    for (int depth = 1; depth < 200000; depth++) {
+        std::string top = "/c" + std::to_string(depth);
+        fs->mkdir(top);
+        fs->rename("/c" + std::to_string(depth - 1), top + "/d");
+    }
+    EXPECT_EQ(fs->usage("/c199999").dirs, 200000);
+    EXPECT_TRUE(fs->rm("/c199999", true));
+    fs->waitForReclaim();
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->nodeCount(), baseline);
+}
+
+#ifdef FS_CONCURRENT
+TEST_F(FileSystemTest, ConcurrentTransactionsNeverExposeHalfGroups) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/pair", true);
+    fs->createFile("/pair/left", "0", true);
+    fs->createFile("/pair/right", "0", true);
+    std::thread writer([this] {
+        for (int i = 1; i <= 500; i++) {
+            Transaction tx = fs->beginTransaction();
+            tx.write("/pair/left", std::to_string(i));
+            tx.write("/pair/right", std::to_string(i));
+            EXPECT_TRUE(tx.commit());
+        }
+    });
+    int consistent = 0;
+    while (consistent < 500) {
+        Transaction tx = fs->beginTransaction();
+        std::string left = tx.read("/pair/left");
+        std::string right = tx.read("/pair/right");
+        if (tx.commit()) {
+            EXPECT_EQ(left, right);
+            consistent++;
+        }
+    }
+    writer.join();
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/pair/left"), "500");
+}
+
+TEST_F(FileSystemTest, ConcurrentSnapshotsNeverSplitTransactions) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/pair", true);
+    fs->createFile("/pair/left", "0", true);
+    fs->createFile("/pair/right", "0", true);
+    std::thread writer([this] {
+        for (int i = 1; i <= 500; i++) {
+            Transaction tx = fs->beginTransaction();
+            tx.write("/pair/left", std::to_string(i));
+            tx.write("/pair/right", std::to_string(i));
+            EXPECT_TRUE(tx.commit());
+        }
+    });
+    for (int i = 0; i < 50; i++) {
+        std::string name = "s" + std::to_string(i);
+        ASSERT_TRUE(fs->snapshot(name));
+        std::string left = fs->readFile("/.snapshots/" + name + "/pair/left");
+        EXPECT_EQ(left, fs->readFile("/.snapshots/" + name + "/pair/right"));
+        if (i % 2) {
+            EXPECT_TRUE(fs->deleteSnapshot(name));
+        }
+    }
+    writer.join();
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->listSnapshots().size(), 25u);
+}
+
+TEST_F(FileSystemTest, ConcurrentUsageStaysExact) {
+    testing::internal::CaptureStdout();
+    const int writers = 4;
+    const int appends = 300;
+    fs->createDirectory("/a", true);
+    fs->createDirectory("/b", true);
+    fs->createDirectory("/a/mid", true);
+    for (int t = 0; t < writers; t++) {
+        fs->createDirectory("/a/mid/d" + std::to_string(t), true);
+        fs->createFile("/a/mid/d" + std::to_string(t) + "/f", "", true);
+    }
+    std::atomic<bool> stop(false);
+    std::thread mover([this, &stop] {
+        for (int i = 0; !stop; i++) {
+            fs->rename(i % 2 ? "/b/mid" : "/a/mid", i % 2 ? "/a/mid" : "/b/mid");
+        }
+    });
+    std::thread churn([this, &stop] {
+        for (int i = 0; !stop; i++) {
+            std::string name = "/a/tmp" + std::to_string(i % 8);
+            fs->createFile(name, "abc", true);
+            fs->rm(name);
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < writers; t++) {
+        threads.emplace_back([this, t] {
+            std::string tail = "/mid/d" + std::to_string(t) + "/f";
+            for (int i = 0; i < appends; i++) {
+                while (!fs->writeToFile("/a" + tail, "x") && !fs->writeToFile("/b" + tail, "x")) {}
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stop = true;
+    mover.join();
+    churn.join();
+    testing::internal::GetCapturedStdout();
+    
+    Usage total = fs->usage("/");
+    EXPECT_EQ(total.bytes, writers * appends);
+    EXPECT_EQ(total.files, writers);
+    EXPECT_EQ(total.dirs, 4 + writers);
+    Usage a = fs->usage("/a"), b = fs->usage("/b");
+    EXPECT_EQ(a.bytes + b.bytes, writers * appends);
+    EXPECT_EQ(a.dirs + b.dirs, 3 + writers);
+}
+
+TEST_F(FileSystemTest, ConcurrentSearchSeesStableEntriesOnce) {
+    testing::internal::CaptureStdout();
+    for (int d = 0; d < 16; d++) {
+        fs->createDirectory("/d" + std::to_string(d), true);
+        fs->createFile("/d" + std::to_string(d) + "/keep", "", true);
+    }
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> churn;
+    for (int t = 0; t < 2; t++) {
+        churn.emplace_back([this, t, &stop] {
+            for (int i = 0; !stop; i++) {
+                std::string dir = "/d" + std::to_string((i + t) % 16) + "/tmp" + std::to_string(t);
+                fs->createDirectory(dir, true);
+                fs->createFile(dir + "/keepsake", "", true);
+                fs->rm(dir, true);
+            }
+        });
+    }
+    fs->setWalkThreads(4);
+    for (int round = 0; round < 50; round++) {
+        auto found = fs->search("keep");
+        size_t stable = std::count_if(found.begin(), found.end(), [](const std::string& path) {
+            return path.size() >= 5 && path.compare(path.size() - 5, 5, "/keep") == 0;
+        });
+        EXPECT_EQ(stable, 16u);
+    }
+    stop = true;
+    for (auto& thread : churn) {
+        thread.join();
+    }
+    testing::internal::GetCapturedStdout();
+}
+
+TEST_F(FileSystemTest, ConcurrentRenameKeepsNamesWhole) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/top", true);
+    fs->createDirectory("/top/inner", true);
+    fs->createDirectory("/top/inner/deep", true);
+    fs->createFile("/top/inner/deep/leaf", "", true);
+    fs->changeDirectory("/top/inner/deep");
+    std::atomic<bool> stop(false);
+    std::thread renamer([this, &stop] {
+        for (int i = 0; !stop; i++) {
+            if (i % 2 == 0) {
+                fs->rename("/top/inner", "/top/other");
+            } else {
+                fs->rename("/top/other", "/top/inner");
+            }
+        }
+    });
+    for (int round = 0; round < 2000; round++) {
+        std::string path = fs->getCurrentPath();
+        EXPECT_TRUE(path == "/top/inner/deep" || path == "/top/other/deep") << path;
+        DirCursor cursor = fs->openDir("/top");
+        for (const auto& entry : fs->readDir(cursor, 8)) {
+            EXPECT_TRUE(entry.name == "inner" || entry.name == "other") << entry.name;
+        }
+    }
+    stop = true;
+    renamer.join();
+    testing::internal::GetCapturedStdout();
+}
+
+TEST_F(FileSystemTest, ConcurrentRenamesConserveEntries) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/a", true);
+    fs->createDirectory("/b", true);
+    const int threads = 4;
+    const int files = 50;
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < files; i++) {
+            fs->createFile("/a/f" + std::to_string(t) + "_" + std::to_string(i), "x", true);
+        }
+    }
+    std::atomic<bool> stop(false);
+    std::thread reader([this, &stop] {
+        while (!stop) {
+            for (int i = 0; i < files; i++) {
+                for (std::string path : {"/a/f0_", "/b/g0_"}) {
+                    std::string content = fs->readFile(path + std::to_string(i));
+                    EXPECT_TRUE(content.empty() || content == "x");
+                }
+            }
+        }
+    });
+    std::vector<std::thread> movers;
+    for (int t = 0; t < threads; t++) {
+        movers.emplace_back([this, t] {
+            for (int round = 0; round < 4; round++) {
+                for (int i = 0; i < files; i++) {
+                    std::string suffix = std::to_string(t) + "_" + std::to_string(i);
+                    if (round % 2 == 0) {
+                        EXPECT_TRUE(fs->rename("/a/f" + suffix, "/b/g" + suffix));
+                    } else {
+                        EXPECT_TRUE(fs->rename("/b/g" + suffix, "/a/f" + suffix));
+                    }
+                }
+            }
+        });
+    }
+    for (auto& mover : movers) {
+        mover.join();
+    }
+    stop = true;
+    reader.join();
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->openDir("/a").dir->htree().size(), (size_t)(threads * files));
+    EXPECT_EQ(fs->openDir("/b").dir->htree().size(), 0u);
+}
+
+TEST_F(FileSystemTest, ConcurrentCreateLookupAppend) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/shared", true);
+    fs->createFile("/shared/log", "", true);
+    const int threads = 8;
+    const int files = 200;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([this, t] {
+            std::string dir = "/shared/t" + std::to_string(t);
+            fs->createDirectory(dir, true);
+            for (int i = 0; i < files; i++) {
+                std::string path = dir + "/f" + std::to_string(i);
+                fs->createFile(path, "x", true);
+                fs->appendFile(path, "y");
+                fs->appendFile("/shared/log", "z");
+                fs->readFile("/shared/t" + std::to_string((t + 1) % threads) + "/f" + std::to_string(i));
+                if (i % 50 == 49) {
+                    fs->rm(dir + "/f" + std::to_string(i - 1));
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/shared/log").size(), (size_t)threads * files);
+    for (int t = 0; t < threads; t++) {
+        std::string dir = "/shared/t" + std::to_string(t);
+        EXPECT_EQ(fs->readFile(dir + "/f0"), "xy");
+        EXPECT_EQ(fs->readFile(dir + "/f48"), "");
+        EXPECT_EQ(fs->search("f" + std::to_string(files - 1)).size(), (size_t)threads);
+    }
+}
+
+TEST_F(FileSystemTest, ConcurrentLookupsDuringChurn) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/hot", true);
+    for (int i = 0; i < 100; i++) {
+        fs->createFile("/hot/stable" + std::to_string(i), "s", true);
+    }
+    std::atomic<bool> stop(false);
+    std::thread writer([this, &stop] {
+        for (int round = 0; round < 20; round++) {
+            for (int i = 0; i < 200; i++) {
+                fs->createFile("/hot/temp" + std::to_string(i), "t", true);
+            }
+            for (int i = 0; i < 200; i++) {
+                fs->rm("/hot/temp" + std::to_string(i));
+            }
+        }
+        stop = true;
+    });
+    std::vector<std::thread> readers;
+    std::atomic<int> misses(0);
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([this, &stop, &misses] {
+            for (int i = 0; !stop; i = (i + 1) % 100) {
+                if (fs->readFile("/hot/stable" + std::to_string(i)) != "s") {
+                    misses++;
+                }
+                fs->readFile("/hot/temp" + std::to_string(i));
+            }
+        });
+    }
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(misses, 0);
+    EXPECT_EQ(fs->readFile("/hot/temp0"), "");
+}
+
+TEST_F(FileSystemTest, ConcurrentRemoveWhileWalking) {
+    testing::internal::CaptureStdout();
+    std::string deep;
+    for (int i = 0; i < 32; i++) {
+        deep += "/d" + std::to_string(i);
+        fs->createDirectory(deep, true);
+        fs->createFile(deep + "/f", "data", true);
+    }
+    std::thread walker([this, deep] {
+        for (int round = 0; round < 2000; round++) {
+            fs->readFile(deep + "/f");
+            fs->changeDirectory(deep);
+            fs->changeDirectory("..");
+            fs->getCurrentPath();
+        }
+    });
+    for (int round = 0; round < 50; round++) {
+        fs->rm("/d0", true);
+        std::string path;
+        for (int i = 0; i < 32; i++) {
+            path += "/d" + std::to_string(i);
+            fs->createDirectory(path, true);
+        }
+    }
+    walker.join();
+    testing::internal::GetCapturedStdout();
+    EXPECT_NE(fs->getCurrentPath(), "");
+}
+#endif
+
 TEST_F(FileSystemTest, WriteFile) {
     testing::internal::CaptureStdout();
     fs->touch("test.txt");
@@ -394,7 +1907,16 @@ TEST_F(FileSystemTest, ChmodFile) {
     testing::internal::CaptureStdout();
     fs->touch("test.txt");
     EXPECT_TRUE(fs->chmod("644", "test.txt"));
+    EXPECT_FALSE(fs->chmod("800", "test.txt"));
+    EXPECT_FALSE(fs->chmod("6a4", "test.txt"));
+    EXPECT_FALSE(fs->chmod("-44", "test.txt"));
+    EXPECT_FALSE(fs->setPermissions("/test.txt", 9, 5, 5));
+    EXPECT_FALSE(fs->setPermissions("/test.txt", 7, -1, 5));
+    DirCursor cursor = fs->openDir("/");
+    auto entries = fs->readDir(cursor, 10);
     testing::internal::GetCapturedStdout();
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].permissions.mode(), 0644);
 }
 
 TEST_F(FileSystemTest, PermissionCheck) {
@@ -477,6 +1999,193 @@ TEST_F(FileSystemTest, RemoveNonEmptyDirectoryWithoutRecursive) {
     testing::internal::GetCapturedStdout();
 }
 
+TEST_F(FileSystemTest, LsSortedAndPrefixGlob) {
+    testing::internal::CaptureStdout();
+    fs->touch("beta");
+    fs->touch("alpha");
+    fs->touch("alps");
+    testing::internal::GetCapturedStdout();
+
+    testing::internal::CaptureStdout();
+    fs->ls(false);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "alpha  alps  beta  \n");
+
+    testing::internal::CaptureStdout();
+    fs->ls("al*", false);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "alpha  alps  \n");
+}
+
+TEST_F(FileSystemTest, ReadDirBatches) {
+    testing::internal::CaptureStdout();
+    fs->mkdir("big");
+    for (int i = 0; i < 100; i++) {
+        fs->touch("big/f" + std::to_string(i));
+    }
+    testing::internal::GetCapturedStdout();
+
+    DirCursor cursor = fs->openDir("/big");
+    ASSERT_TRUE(cursor.valid());
+    std::set<std::string> seen;
+    for (auto batch = fs->readDir(cursor, 7); !batch.empty(); batch = fs->readDir(cursor, 7)) {
+        EXPECT_LE(batch.size(), 7);
+        for (const auto& entry : batch) {
+            EXPECT_TRUE(seen.insert(entry.name).second);
+        }
+    }
+    EXPECT_EQ(seen.size(), 100);
+    EXPECT_FALSE(fs->openDir("/missing").valid());
+}
+
+TEST_F(FileSystemTest, ReadDirReportsLargeDirectoryTotals) {
+    testing::internal::CaptureStdout();
+    fs->mkdir("big");
+    testing::internal::GetCapturedStdout();
+    const int64_t total = int64_t(3) << 30;
+    fs->openDir("/big").dir->htree().addUsage({total, 0, 0});
+
+    DirCursor cursor = fs->openDir("/");
+    bool found = false;
+    for (const auto& entry : fs->readDir(cursor, 10)) {
+        if (entry.name == "big") {
+            EXPECT_EQ(entry.size, total);
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST_F(FileSystemTest, ReadDirResumesAfterConcurrentChanges) {
+    for (bool sorted : {false, true}) {
+        std::string dir = sorted ? "/sorted" : "/hashed";
+        testing::internal::CaptureStdout();
+        fs->mkdir(dir.substr(1));
+        for (int i = 0; i < 100; i++) {
+            fs->touch(dir + "/f" + std::to_string(i));
+        }
+        testing::internal::GetCapturedStdout();
+
+        DirCursor cursor = fs->openDir(dir, sorted);
+        std::set<std::string> seen;
+        std::set<std::string> removed;
+        int round = 0;
+        for (auto batch = fs->readDir(cursor, 10); !batch.empty(); batch = fs->readDir(cursor, 10)) {
+            for (const auto& entry : batch) {
+                EXPECT_TRUE(seen.insert(entry.name).second) << entry.name;
+            }
+            std::string victim = "f" + std::to_string(99 - round);
+            testing::internal::CaptureStdout();
+            fs->touch(dir + "/new" + std::to_string(round));
+            if (fs->rm(dir + "/" + victim)) {
+                removed.insert(victim);
+            }
+            testing::internal::GetCapturedStdout();
+            round++;
+        }
+        for (int i = 0; i < 100; i++) {
+            std::string name = "f" + std::to_string(i);
+            EXPECT_TRUE(seen.count(name) || removed.count(name)) << name;
+        }
+    }
+}
+
+TEST_F(FileSystemTest, SortedListingKeepsNameOrder) {
+    testing::internal::CaptureStdout();
+    fs->mkdir("big");
+    for (int i = 0; i < 100; i++) {
+        fs->touch("big/f" + std::to_string(i));
+    }
+    testing::internal::GetCapturedStdout();
+
+    DirCursor cursor = fs->openDir("/big", true);
+    const HTreeIndex& index = cursor.dir->htree();
+    while (!fs->readDir(cursor, 10).empty()) {
+    }
+    EXPECT_TRUE(cursor.eof);
+    EXPECT_EQ(index.nameOrderSize(), 100u);
+
+    testing::internal::CaptureStdout();
+    fs->touch("big/a");
+    fs->rm("big/f5");
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(index.nameOrderSize(), 100u);
+
+    cursor = fs->openDir("/big", true);
+    auto page = fs->readDir(cursor, 3);
+    ASSERT_EQ(page.size(), 3u);
+    EXPECT_EQ(page[0].name, "a");
+    EXPECT_EQ(page[1].name, "f0");
+    EXPECT_EQ(page[2].name, "f1");
+}
+
+TEST_F(FileSystemTest, FreezeKeepsTreeUsable) {
+    testing::internal::CaptureStdout();
+    fs->mkdir("data");
+    fs->mkdir("data/sub");
+    for (int i = 0; i < 50; i++) {
+        fs->touch("/data/f" + std::to_string(i));
+        fs->touch("/data/sub/g" + std::to_string(i));
+    }
+    EXPECT_TRUE(fs->freeze("/data"));
+    EXPECT_FALSE(fs->freeze("/missing"));
+    testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(fs->readFile("/data/sub/g7"), "");
+    EXPECT_EQ(fs->search("g4").size(), 11);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(fs->writeToFile("/data/f3", "hello"));
+    EXPECT_TRUE(fs->createFile("/data/sub/new.txt", "x"));
+    EXPECT_TRUE(fs->remove("/data/f0"));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/data/f3"), "hello");
+    EXPECT_EQ(fs->readFile("/data/sub/new.txt"), "x");
+    EXPECT_EQ(fs->search("f0").size(), 0);
+}
+
+TEST_F(FileSystemTest, PathsWithRedundantSeparators) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/a", true);
+    fs->createDirectory("//a/./b/", true);
+    fs->createFile("/a/b//file.txt", "data", true);
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/a/./b/file.txt"), "data");
+    EXPECT_EQ(fs->readFile("a/b/file.txt"), "data");
+    EXPECT_EQ(fs->readFile("/a/b/file.txt/"), "data");
+    EXPECT_EQ(fs->readFile("/a/b/missing.txt"), "");
+}
+
+TEST(PathIteratorTest, YieldsComponentsInPlace) {
+    std::string path = "//usr/./local//bin/";
+    std::vector<std::string> names;
+    PathIterator it(path);
+    for (; !it.done(); ++it) {
+        EXPECT_GE(it->name.data(), path.data());
+        EXPECT_LT(it->name.data(), path.data() + path.size());
+        EXPECT_EQ(it->hash, HashFunction::hash(it->name));
+        EXPECT_EQ(it.isLast(), it->name == "bin");
+        names.emplace_back(it->name);
+    }
+    EXPECT_EQ(names, std::vector<std::string>({"usr", "local", "bin"}));
+    EXPECT_TRUE(PathIterator("/./").done());
+    EXPECT_TRUE(PathIterator("").done());
+}
+
+TEST_F(FileSystemTest, WriteAndRmResolveParentAndLeaf) {
+    testing::internal::CaptureStdout();
+    fs->createDirectory("/a", true);
+    fs->createDirectory("/a/b", true);
+    fs->changeDirectory("/a");
+    EXPECT_TRUE(fs->writeFile("b/new.txt", "fresh"));
+    EXPECT_TRUE(fs->writeFile("../a/b/new.txt", "again"));
+    EXPECT_FALSE(fs->writeFile("missing/new.txt", "x"));
+    EXPECT_FALSE(fs->writeFile("b/..", "x"));
+    EXPECT_FALSE(fs->rm("b/absent.txt"));
+    EXPECT_TRUE(fs->rm("./b//new.txt"));
+    EXPECT_TRUE(fs->rm("b/", true));
+    EXPECT_FALSE(fs->changeDirectory("/a/b"));
+    testing::internal::GetCapturedStdout();
+    EXPECT_EQ(fs->readFile("/a/b/new.txt"), "");
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();